@@ -73,6 +73,8 @@ static char *ConfigMixerChannel;	///< audio mixer channel
 static const char *ConfigMplayer = "/usr/bin/mplayer";	///< mplayer executable
 static const char *ConfigX11Display = ":0.0";	///< x11 display
 static uint32_t ConfigColorKey = 0x00020507;	///< color key
+static char ConfigOsdArgb;		///< osd uses argb visual
+static char ConfigOsdShape;		///< osd transparency by x shape
 
 //////////////////////////////////////////////////////////////////////////////
 //	Menu
@@ -256,7 +258,11 @@ extern "C"
 	    "  -g geometry\tx11 window geometry wxh+x+y\n"
 	    "  -k colorkey\tvideo color key (default=0x020507, mplayer2=0x76B901)\n"
 	    "  -m mplayer\tfilename of mplayer executable\n"
-	    "  -o\t\tosd overlay experiments\n" "  -s\t\tmplayer slave mode\n"
+	    "  -o\t\tosd overlay experiments\n"
+	    "  -r size\tfixed osd size wxh, scaled into the window\n"
+	    "  -s\t\tmplayer slave mode\n"
+	    "  -t\t\tosd alpha blending with argb visual (needs compositing manager)\n"
+	    "  -x\t\tosd transparency with x shape extension (no color key)\n"
 	    "  -v video\tmplayer -vo (vdpau:deint=4:hqscaling=1) overwrites mplayer.conf\n";
     }
 
@@ -284,7 +290,7 @@ extern "C"
 	}
 
 	for (;;) {
-	    switch (getopt(argc, argv, "-a:d:fg:k:m:osv:")) {
+	    switch (getopt(argc, argv, "-a:d:fg:k:m:or:stv:x")) {
 		case 'a':		// audio out
 		    ConfigAudioOut = optarg;
 		    continue;
@@ -306,12 +312,21 @@ extern "C"
 		case 'o':		// osd / overlay
 		    ConfigOsdOverlay = 1;
 		    continue;
+		case 'r':		// osd resolution
+		    VideoSetOsdSize(optarg);
+		    continue;
 		case 's':		// slave mode
 		    ConfigUseSlave = 1;
 		    continue;
+		case 't':		// true color osd
+		    ConfigOsdArgb = 1;
+		    continue;
 		case 'v':		// video out
 		    ConfigVideoOut = optarg;
 		    continue;
+		case 'x':		// x shape osd
+		    ConfigOsdShape = 1;
+		    continue;
 		case EOF:
 		    break;
 		case '-':
@@ -339,107 +354,638 @@ extern "C"
 //	Slave
 //////////////////////////////////////////////////////////////////////////////
 
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
 static pid_t PlayerPid;			///< player pid
-static char PipeBuf[1024];		///< pipe buffer
-static int PipeCnt;			///< pipe buffer count
-static int PipeIdx;			///< pipe buffer index
+static char *PipeRing;			///< pipe ring buffer, mapped twice
+static size_t PipeRingSize;		///< size of pipe ring buffer
+static size_t PipeHead;			///< ring index of first unparsed byte
+static size_t PipeCount;		///< unparsed bytes in ring
+static size_t PipeScan;			///< unparsed bytes without newline
 static int PipeOut[2];			///< player write pipe
 static int PipeIn[2];			///< player read pipe
-static char DvdNav;			///< dvdnav active
+static int PlayerEventFd = -1;		///< wakeup of player thread
 static int PlayerVolume = -1;		///< volume 0 - 100
 static char PlayerPaused;		///< player paused
 static char PlayerSpeed;		///< player playback speed
+static int PlayerTimePosQueries;	///< position queries sent
 
 /*
 static enum __player_state_ {
 } PlayerState;				///< player state
 */
 
+    /// Maximal number of audio/subtitle tracks in player info.
+#define PLAYER_TRACKS_MAX 32
+    /// Maximal number of clip infos in player info.
+#define PLAYER_CLIP_INFOS_MAX 8
+    /// Maximal number of dvd titles in player info, numbered from 1.
+#define PLAYER_DVD_TITLES_MAX 100
+    /// Maximal number of chapters in player info.
+#define PLAYER_CHAPTERS_MAX 64
+    /// Maximal number of cd tracks in player info, numbered from 1.
+#define PLAYER_CD_TRACKS_MAX 100
+
 /**
-**	Parse player output.
+**	Stream metadata and state reported by the player.
+**
+**	Filled from the ID_*, ANS_* and DVDNAV_* lines of the slave output.
+*/
+typedef struct __player_info_
+{
+    char DvdNav;			///< dvdnav active, 1 menu, 2 movie
+    int TimePos;			///< position in seconds
+    int TimePosAnswers;			///< number of position answers
+    int Length;				///< stream length in seconds
+    double StartTime;			///< start time in seconds
+    int PercentPos;			///< position in percent
+    char Seekable;			///< stream is seekable
+    int Chapters;			///< number of chapters
+    int Chapter;			///< current chapter
+    double Speed;			///< playback speed
+    double Volume;			///< volume 0 - 100
+    char Mute;				///< audio muted
+    char Paused;			///< player paused
+    int Signal;				///< signal which stopped the player
+    char Filename[256];			///< filename of stream
+    char Demuxer[32];			///< demuxer name
+    char Exit[32];			///< exit reason
+
+    char VideoFormat[32];		///< video format
+    char VideoCodec[32];		///< video codec
+    char VideoResolution[32];		///< video resolution
+    int VideoBitrate;			///< video bitrate
+    int VideoWidth;			///< video width
+    int VideoHeight;			///< video height
+    double VideoFps;			///< video frames per second
+    double VideoAspect;			///< video aspect ratio
+    int VideoTracks;			///< number of video tracks
+
+    char AudioFormat[32];		///< audio format
+    char AudioCodec[32];		///< audio codec
+    int AudioBitrate;			///< audio bitrate
+    int AudioRate;			///< audio sample rate
+    int AudioChannels;			///< audio channels
+    int AudioTracks;			///< number of audio tracks
+    int AudioId;			///< current audio track
+    char AudioLang[PLAYER_TRACKS_MAX][16];	///< audio track languages
+    char AudioName[PLAYER_TRACKS_MAX][64];	///< audio track names
+
+    int SubtitleTracks;			///< number of subtitle tracks
+    int FileSubtitleTracks;		///< number of subtitle files
+    int SubtitleId;			///< current subtitle
+    char SubtitleLang[PLAYER_TRACKS_MAX][16];	///< subtitle languages
+    char SubtitleName[PLAYER_TRACKS_MAX][64];	///< subtitle names
+
+    char DvdVolumeId[64];		///< dvd volume id
+    int DvdTitles;			///< number of dvd titles
+    int DvdCurrentTitle;		///< current dvd title
+    char DvdDiscId[40];			///< dvd disc id
+    int DvdTitleLength[PLAYER_DVD_TITLES_MAX];	///< dvd title lengths in s
+    int DvdTitleChapters[PLAYER_DVD_TITLES_MAX];	///< dvd title chapters
+    int DvdTitleAngles[PLAYER_DVD_TITLES_MAX];	///< dvd title angles
+
+    int ChapterStart[PLAYER_CHAPTERS_MAX];	///< chapter start in ms
+    int ChapterEnd[PLAYER_CHAPTERS_MAX];	///< chapter end in ms
+    char ChapterName[PLAYER_CHAPTERS_MAX][64];	///< chapter names
+
+    int CddaTracks;			///< number of audio cd tracks
+    char CddaTrackMsf[PLAYER_CD_TRACKS_MAX][12];	///< audio cd track lengths
+    int VcdStartTrack;			///< first video cd track
+    int VcdEndTrack;			///< last video cd track
+    char VcdTrackMsf[PLAYER_CD_TRACKS_MAX][12];	///< video cd track lengths
+
+    int ClipInfos;			///< number of clip infos
+    char ClipName[PLAYER_CLIP_INFOS_MAX][32];	///< clip info names
+    char ClipValue[PLAYER_CLIP_INFOS_MAX][128];	///< clip info values
+    char MetaTitle[128];		///< meta title
+    char MetaArtist[128];		///< meta artist
+    char MetaAlbum[128];		///< meta album
+    char MetaYear[16];			///< meta year
+    char MetaComment[128];		///< meta comment
+    char MetaTrack[16];			///< meta track
+    char MetaGenre[64];			///< meta genre
+    char Error[64];			///< last command error
+} PlayerInfo;
+
+static PlayerInfo StreamInfo;		///< metadata of playing stream
+static cMutex StreamInfoMutex;		///< lock of StreamInfo
+
+/**
+**	Type of player key value.
+*/
+typedef enum __player_value_type_
+{
+    PlayerValueInt,			///< int field
+    PlayerValueDouble,			///< double field
+    PlayerValueSeconds,			///< int field from seconds with fraction
+    PlayerValueBool,			///< char field, yes/no or 1/0
+    PlayerValueString,			///< char array field
+    PlayerValueTrack,			///< int field, highest track id + 1
+    PlayerValueConst,			///< char field, set to constant
+} PlayerValueType;
+
+/**
+**	Key of player output.
+*/
+typedef struct __player_key_
+{
+    const char *Name;			///< key, number replaced by '#'
+    PlayerValueType Type;		///< type of value
+    size_t Offset;			///< offset of field in PlayerInfo
+    int Size;				///< array element size or constant value
+    int Count;				///< array elements indexed by number
+} PlayerKey;
+
+#define PLAYER_FIELD(field) \
+    offsetof(PlayerInfo, field)
+#define PLAYER_COUNT(field) \
+    (sizeof(StreamInfo.field) / sizeof(StreamInfo.field[0]))
+#define PLAYER_INT(name, field) \
+    { name, PlayerValueInt, PLAYER_FIELD(field), 0, 0 }
+#define PLAYER_INTS(name, field) \
+    { name, PlayerValueInt, PLAYER_FIELD(field), \
+	sizeof(StreamInfo.field[0]), PLAYER_COUNT(field) }
+#define PLAYER_DOUBLE(name, field) \
+    { name, PlayerValueDouble, PLAYER_FIELD(field), 0, 0 }
+#define PLAYER_SECONDS(name, field) \
+    { name, PlayerValueSeconds, PLAYER_FIELD(field), 0, 0 }
+#define PLAYER_SECONDS_ARRAY(name, field) \
+    { name, PlayerValueSeconds, PLAYER_FIELD(field), \
+	sizeof(StreamInfo.field[0]), PLAYER_COUNT(field) }
+#define PLAYER_BOOL(name, field) \
+    { name, PlayerValueBool, PLAYER_FIELD(field), 0, 0 }
+#define PLAYER_STRING(name, field) \
+    { name, PlayerValueString, PLAYER_FIELD(field), \
+	sizeof(StreamInfo.field), 0 }
+#define PLAYER_STRINGS(name, field) \
+    { name, PlayerValueString, PLAYER_FIELD(field), \
+	sizeof(StreamInfo.field[0]), PLAYER_COUNT(field) }
+#define PLAYER_TRACK(name, field) \
+    { name, PlayerValueTrack, PLAYER_FIELD(field), 0, 0 }
+#define PLAYER_CONST(name, field, value) \
+    { name, PlayerValueConst, PLAYER_FIELD(field), value, 0 }
+
+/**
+**	All known keys of player output.
+*/
+static const PlayerKey PlayerKeys[] = {
+    PLAYER_CONST("DVDNAV_TITLE_IS_MENU", DvdNav, 1),
+    PLAYER_CONST("DVDNAV_TITLE_IS_MOVIE", DvdNav, 2),
+
+    PLAYER_SECONDS("ANS_TIME_POSITION", TimePos),
+    PLAYER_SECONDS("ANS_time_pos", TimePos),
+    PLAYER_SECONDS("ANS_LENGTH", Length),
+    PLAYER_INT("ANS_PERCENT_POSITION", PercentPos),
+    PLAYER_INT("ANS_percent_pos", PercentPos),
+    PLAYER_INT("ANS_chapter", Chapter),
+    PLAYER_DOUBLE("ANS_speed", Speed),
+    PLAYER_DOUBLE("ANS_volume", Volume),
+    PLAYER_BOOL("ANS_mute", Mute),
+    PLAYER_BOOL("ANS_pause", Paused),
+    PLAYER_INT("ANS_switch_audio", AudioId),
+    PLAYER_INT("ANS_sub", SubtitleId),
+    PLAYER_STRING("ANS_filename", Filename),
+    PLAYER_STRING("ANS_VIDEO_CODEC", VideoCodec),
+    PLAYER_STRING("ANS_VIDEO_RESOLUTION", VideoResolution),
+    PLAYER_STRING("ANS_AUDIO_CODEC", AudioCodec),
+    PLAYER_STRING("ANS_META_TITLE", MetaTitle),
+    PLAYER_STRING("ANS_META_ARTIST", MetaArtist),
+    PLAYER_STRING("ANS_META_ALBUM", MetaAlbum),
+    PLAYER_STRING("ANS_META_YEAR", MetaYear),
+    PLAYER_STRING("ANS_META_COMMENT", MetaComment),
+    PLAYER_STRING("ANS_META_TRACK", MetaTrack),
+    PLAYER_STRING("ANS_META_GENRE", MetaGenre),
+    PLAYER_STRING("ANS_ERROR", Error),
+
+    PLAYER_STRING("ID_FILENAME", Filename),
+    PLAYER_STRING("ID_DEMUXER", Demuxer),
+    PLAYER_SECONDS("ID_LENGTH", Length),
+    PLAYER_DOUBLE("ID_START_TIME", StartTime),
+    PLAYER_BOOL("ID_SEEKABLE", Seekable),
+    PLAYER_INT("ID_CHAPTERS", Chapters),
+    PLAYER_TRACK("ID_CHAPTER_ID", Chapters),
+    PLAYER_INTS("ID_CHAPTER_#_START", ChapterStart),
+    PLAYER_INTS("ID_CHAPTER_#_END", ChapterEnd),
+    PLAYER_STRINGS("ID_CHAPTER_#_NAME", ChapterName),
+    PLAYER_STRING("ID_EXIT", Exit),
+    PLAYER_INT("ID_SIGNAL", Signal),
+
+    PLAYER_TRACK("ID_VIDEO_ID", VideoTracks),
+    PLAYER_STRING("ID_VIDEO_FORMAT", VideoFormat),
+    PLAYER_STRING("ID_VIDEO_CODEC", VideoCodec),
+    PLAYER_INT("ID_VIDEO_BITRATE", VideoBitrate),
+    PLAYER_INT("ID_VIDEO_WIDTH", VideoWidth),
+    PLAYER_INT("ID_VIDEO_HEIGHT", VideoHeight),
+    PLAYER_DOUBLE("ID_VIDEO_FPS", VideoFps),
+    PLAYER_DOUBLE("ID_VIDEO_ASPECT", VideoAspect),
+
+    PLAYER_TRACK("ID_AUDIO_ID", AudioTracks),
+    PLAYER_STRING("ID_AUDIO_FORMAT", AudioFormat),
+    PLAYER_STRING("ID_AUDIO_CODEC", AudioCodec),
+    PLAYER_INT("ID_AUDIO_BITRATE", AudioBitrate),
+    PLAYER_INT("ID_AUDIO_RATE", AudioRate),
+    PLAYER_INT("ID_AUDIO_NCH", AudioChannels),
+    PLAYER_STRINGS("ID_AID_#_LANG", AudioLang),
+    PLAYER_STRINGS("ID_AID_#_NAME", AudioName),
+
+    PLAYER_TRACK("ID_SUBTITLE_ID", SubtitleTracks),
+    PLAYER_STRINGS("ID_SID_#_LANG", SubtitleLang),
+    PLAYER_STRINGS("ID_SID_#_NAME", SubtitleName),
+    PLAYER_TRACK("ID_FILE_SUB_ID", FileSubtitleTracks),
+
+    PLAYER_STRING("ID_DVD_VOLUME_ID", DvdVolumeId),
+    PLAYER_INT("ID_DVD_TITLES", DvdTitles),
+    PLAYER_INT("ID_DVD_CURRENT_TITLE", DvdCurrentTitle),
+    PLAYER_STRING("ID_DVD_DISC_ID", DvdDiscId),
+    PLAYER_SECONDS_ARRAY("ID_DVD_TITLE_#_LENGTH", DvdTitleLength),
+    PLAYER_INTS("ID_DVD_TITLE_#_CHAPTERS", DvdTitleChapters),
+    PLAYER_INTS("ID_DVD_TITLE_#_ANGLES", DvdTitleAngles),
+
+    PLAYER_INT("ID_CDDA_TRACKS", CddaTracks),
+    PLAYER_STRINGS("ID_CDDA_TRACK_#_MSF", CddaTrackMsf),
+    PLAYER_INT("ID_VCD_START_TRACK", VcdStartTrack),
+    PLAYER_INT("ID_VCD_END_TRACK", VcdEndTrack),
+    PLAYER_STRINGS("ID_VCD_TRACK_#_MSF", VcdTrackMsf),
+
+    PLAYER_INT("ID_CLIP_INFO_N", ClipInfos),
+    PLAYER_STRINGS("ID_CLIP_INFO_NAME#", ClipName),
+    PLAYER_STRINGS("ID_CLIP_INFO_VALUE#", ClipValue),
+};
+
+    /// Number of known player keys.
+#define PLAYER_KEY_COUNT (sizeof(PlayerKeys) / sizeof(*PlayerKeys))
+    /// Size of player key hash table, power of 2.
+#define PLAYER_KEY_SLOTS 1024
+    /// Maximal length of player key.
+#define PLAYER_KEY_MAX 48
+
+    /// Perfect hash of player keys: index + 1 into PlayerKeys, 0 = empty.
+static uint8_t PlayerKeySlots[PLAYER_KEY_SLOTS];
+static_assert(PLAYER_KEY_COUNT < 255, "player key index must fit a slot");
+static uint32_t PlayerKeySeed;		///< seed of perfect hash
+
+/**
+**	Hash a player key.
+**
+**	FNV-1a with seed, ascii case is ignored.
+**
+**	@param seed	hash seed
+**	@param key	\0 terminated key
 */
-void PlayerParseLine(const char *data, int size)
+static inline uint32_t PlayerKeyHash(uint32_t seed, const char *key)
 {
-    Debug(3, "player: |%.*s|\n", size, data);
-
-    // data is \0 terminated
-    if (!strncasecmp(data, "DVDNAV_TITLE_IS_MENU", 20)) {
-	DvdNav = 1;
-    } else if (!strncasecmp(data, "DVDNAV_TITLE_IS_MOVIE", 21)) {
-	DvdNav = 2;
-    } else if (!strncasecmp(data, "ID_DVD_VOLUME_ID=", 17)) {
-	Debug(3, "DVD_VOLUME = %s\n", data + 17);
-    } else if (!strncasecmp(data, "ID_AID_", 7)) {
-	char lang[64];
-	int aid;
-
-	if ( sscanf(data, "ID_AID_%d_LANG=%s", &aid, lang) == 2 ) {
-	    Debug(3, "AID(%d) = %s\n", aid, lang);
-	}
-    } else if (!strncasecmp(data, "ID_SID_", 7)) {
-	char lang[64];
-	int sid;
+    uint32_t hash;
 
-	if ( sscanf(data, "ID_SID_%d_LANG=%s", &sid, lang) == 2 ) {
-	    Debug(3, "SID(%d) = %s\n", sid, lang);
+    hash = seed ^ 2166136261U;
+    while (*key) {
+	hash ^= (uint8_t) (*key++ | 0x20);
+	hash *= 16777619U;
+    }
+    return hash & (PLAYER_KEY_SLOTS - 1);
+}
+
+/**
+**	Build the perfect hash of the player keys.
+**
+**	Seeds are tried until no two keys share a slot, so a lookup is a
+**	single hash and compare.  Done once, the table is constant.
+*/
+static void PlayerParseInit(void)
+{
+    unsigned i;
+
+    if (PlayerKeySeed) {
+	return;
+    }
+    for (PlayerKeySeed = 1;; ++PlayerKeySeed) {
+	memset(PlayerKeySlots, 0, sizeof(PlayerKeySlots));
+	for (i = 0; i < PLAYER_KEY_COUNT; ++i) {
+	    uint8_t *slot;
+
+	    slot = PlayerKeySlots + PlayerKeyHash(PlayerKeySeed,
+		PlayerKeys[i].Name);
+	    if (*slot) {
+		break;
+	    }
+	    *slot = i + 1;
+	}
+	if (i == PLAYER_KEY_COUNT) {
+	    break;
 	}
     }
+    Debug(3, "play: %zu player keys, hash seed %u\n",
+	PLAYER_KEY_COUNT, PlayerKeySeed);
 }
 
 /**
-**	Poll input pipe.
+**	Get metadata of playing stream.
+**
+**	Updated by the player thread any time, the copy is consistent.
+**
+**	@param[out] info	copy of stream metadata
 */
-void PollPipe(void)
+void GetPlayerInfo(PlayerInfo * info)
 {
-    pollfd poll_fds[1];
+    cMutexLock lock(&StreamInfoMutex);
+
+    *info = StreamInfo;
+}
+
+/**
+**	Parse player output.
+**
+**	Key lines have the form KEY=value or KEY.  The first number in the
+**	key is the array index of the value, it is replaced by '#' for the
+**	lookup.  Keys are matched ignoring case.
+**
+**	@param data	\0 terminated line
+**	@param size	length of line
+*/
+void PlayerParseLine(const char *data, int size)
+{
+    char key[PLAYER_KEY_MAX];
+    const PlayerKey *entry;
+    const char *value;
+    uint8_t *field;
+    int index;
     int n;
     int i;
-    int l;
-
-    // check if something to read
-    poll_fds[0].fd = PipeOut[0];
-    poll_fds[0].events = POLLIN;
 
-    switch (poll(poll_fds, 1, 0)) {
-	case 0:			// timeout
+    // fast reject of normal output, only ID_, ANS_ and DVDNAV_
+    if ((data[0] | 0x20) != 'i' && (data[0] | 0x20) != 'a'
+	&& (data[0] | 0x20) != 'd') {
+	Debug(3, "player: |%.*s|\n", size, data);
+	return;
+    }
+    // key with numbers replaced
+    index = -1;
+    for (i = n = 0; i < size && data[i] != '='; ++n) {
+	if (n == sizeof(key) - 1) {
+	    Debug(3, "player: |%.*s|\n", size, data);
 	    return;
-	case -1:			// error
-	    Error(tr("play/player: poll failed: %s\n"), strerror(errno));
+	}
+	if (data[i] >= '0' && data[i] <= '9') {
+	    int number;
+
+	    for (number = 0; i < size && data[i] >= '0' && data[i] <= '9';
+		++i) {
+		number = number * 10 + data[i] - '0';
+	    }
+	    if (index == -1) {
+		index = number;
+	    }
+	    key[n] = '#';
+	    continue;
+	}
+	key[n] = data[i++];
+    }
+    key[n] = '\0';
+    value = i < size ? data + i + 1 : "";
+
+    n = PlayerKeySlots[PlayerKeyHash(PlayerKeySeed, key)];
+    if (!n || strcasecmp((entry = &PlayerKeys[n - 1])->Name, key)) {
+	Debug(3, "player: |%.*s|\n", size, data);
+	return;
+    }
+
+    cMutexLock lock(&StreamInfoMutex);
+
+    field = (uint8_t *) & StreamInfo + entry->Offset;
+    if (entry->Count) {			// indexed array
+	if (index < 0 || index >= entry->Count) {
 	    return;
-	default:			// ready
+	}
+	field += index * entry->Size;
+    }
+
+    switch (entry->Type) {
+	case PlayerValueInt:
+	    *(int *)field = strtol(value, NULL, 10);
+	    break;
+	case PlayerValueDouble:
+	    *(double *)field = strtod(value, NULL);
+	    break;
+	case PlayerValueSeconds:
+	    *(int *)field = (int)strtod(value, NULL);
+	    break;
+	case PlayerValueBool:
+	    *(char *)field = !strcasecmp(value, "yes") || atoi(value);
+	    break;
+	case PlayerValueString:
+	    // answers may be quoted
+	    n = strlen(value);
+	    if (n >= 2 && value[0] == '\'' && value[n - 1] == '\'') {
+		++value;
+		n -= 2;
+	    }
+	    if (n >= entry->Size) {
+		n = entry->Size - 1;
+	    }
+	    memcpy(field, value, n);
+	    field[n] = '\0';
+	    break;
+	case PlayerValueTrack:
+	    n = strtol(value, NULL, 10);
+	    if (n >= *(int *)field) {
+		*(int *)field = n + 1;
+	    }
 	    break;
+	case PlayerValueConst:
+	    *(char *)field = entry->Size;
+	    break;
+    }
+    // position answer, matched with the queries
+    if (entry->Offset == PLAYER_FIELD(TimePos)) {
+	++StreamInfo.TimePosAnswers;
     }
+}
 
-    // fill buffer
-    if ((n = read(PipeOut[0], PipeBuf + PipeCnt,
-	    sizeof(PipeBuf) - PipeCnt)) < 0) {
-	Error(tr("play/player: read failed: %s\n"), strerror(errno));
-	return;
+    /// Initial size of pipe ring buffer.
+#define PIPE_RING_MIN (4 * 1024)
+    /// Maximal size of pipe ring buffer, longer lines are split.
+#define PIPE_RING_MAX (1024 * 1024)
+
+/**
+**	Map a mirrored ring buffer.
+**
+**	The same memory is mapped twice, one after the other.  Data
+**	wrapping around the end of the ring is contiguous in memory.
+**
+**	@param size	size of ring, multiple of page size
+**
+**	@returns ring buffer of 2 * @p size address space, NULL on failure.
+*/
+static char *PipeRingMap(size_t size)
+{
+    char *ring;
+    int fd;
+
+    if ((fd = memfd_create("play-pipe", MFD_CLOEXEC)) == -1) {
+	Error(tr("play/player: memfd_create failed: %s\n"), strerror(errno));
+	return NULL;
+    }
+    ring = NULL;
+    if (!ftruncate(fd, size)) {
+	// reserve address space, then map the memory into both halves
+	ring =
+	    (char *)mmap(NULL, 2 * size, PROT_NONE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ring == MAP_FAILED) {
+	    ring = NULL;
+	} else if (mmap(ring, size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+	    || mmap(ring + size, size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+	    munmap(ring, 2 * size);
+	    ring = NULL;
+	}
+    }
+    if (!ring) {
+	Error(tr("play/player: can't map ring buffer: %s\n"),
+	    strerror(errno));
+    }
+    close(fd);
+    return ring;
+}
+
+/**
+**	Grow pipe ring buffer.
+**
+**	Unparsed bytes are copied to the start of the new ring.
+**
+**	@returns false if the ring can't grow.
+*/
+static bool PipeRingGrow(void)
+{
+    size_t size;
+    char *ring;
+
+    size = PipeRingSize ? PipeRingSize * 2 : PIPE_RING_MIN;
+    if (size < (size_t) sysconf(_SC_PAGESIZE)) {
+	size = sysconf(_SC_PAGESIZE);
+    }
+    if (size > PIPE_RING_MAX || !(ring = PipeRingMap(size))) {
+	return false;
+    }
+    if (PipeRing) {
+	memcpy(ring, PipeRing + PipeHead, PipeCount);
+	munmap(PipeRing, 2 * PipeRingSize);
+	Debug(3, "play/player: pipe ring grown to %zu bytes\n", size);
+    }
+    PipeRing = ring;
+    PipeRingSize = size;
+    PipeHead = 0;
+    return true;
+}
+
+/**
+**	Free pipe ring buffer.
+*/
+static void PipeRingExit(void)
+{
+    if (PipeRing) {
+	munmap(PipeRing, 2 * PipeRingSize);
+	PipeRing = NULL;
     }
+    PipeRingSize = 0;
+    PipeHead = 0;
+    PipeCount = 0;
+    PipeScan = 0;
+}
+
+/**
+**	Consume a line of the pipe ring buffer.
+**
+**	@param size	bytes of line including its end
+*/
+static void PipeRingConsume(size_t size)
+{
+    PipeHead = (PipeHead + size) & (PipeRingSize - 1);
+    PipeCount -= size;
+    PipeScan = 0;
+}
 
-    PipeCnt += n;
-    l = 0;
-    for (i = PipeIdx; i < PipeCnt; ++i) {
-	if (PipeBuf[i] == '\n') {
-	    PipeBuf[i] = '\0';
-	    PlayerParseLine(PipeBuf + PipeIdx, i - PipeIdx);
-	    PipeIdx = i + 1;
-	    l = PipeIdx;
+/**
+**	Parse all complete lines of the pipe ring buffer.
+**
+**	Lines are parsed in place, also lines wrapping around the ring end.
+*/
+static void PipeRingParse(void)
+{
+    while (PipeScan < PipeCount) {
+	char *line;
+	char *end;
+
+	line = PipeRing + PipeHead;
+	if (!(end = (char *)memchr(line + PipeScan, '\n',
+		    PipeCount - PipeScan))) {
+	    PipeScan = PipeCount;	// don't scan again
+	    break;
 	}
+	*end = '\0';
+	PlayerParseLine(line, end - line);
+	PipeRingConsume(end - line + 1);
     }
+}
 
-    if (l) {				// remove consumed bytes
-	if ( PipeCnt - l ) {
-	    memmove(PipeBuf, PipeBuf + l, PipeCnt - l);
+/**
+**	Read input pipe.
+**
+**	Called when the pipe is ready, reads until the pipe is empty.
+**
+**	@returns false if the player closed the pipe.
+*/
+bool ReadPipe(void)
+{
+    for (;;) {
+	size_t tail;
+	ssize_t n;
+
+	if (PipeCount == PipeRingSize && !PipeRingGrow()) {
+	    if (!PipeRing) {
+		return false;
+	    }
+	    // line too long, use full buffer as single line
+	    PipeRing[PipeHead + PipeCount - 1] = '\0';
+	    PlayerParseLine(PipeRing + PipeHead, PipeCount - 1);
+	    PipeRingConsume(PipeCount);
+	}
+	// free space is contiguous in the mirror
+	tail = (PipeHead + PipeCount) & (PipeRingSize - 1);
+	if ((n = read(PipeOut[0], PipeRing + tail,
+		    PipeRingSize - PipeCount)) < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    if (errno == EAGAIN) {	// all read
+		return true;
+	    }
+	    Error(tr("play/player: read failed: %s\n"), strerror(errno));
+	    return false;
+	}
+	if (!n) {			// end of file
+	    return false;
 	}
-	PipeCnt -= l;
-	PipeIdx -= l;
-    } else if (PipeCnt == sizeof(PipeBuf)) {
-	// no '\n' in buffer use it as single line
-	PipeBuf[sizeof(PipeBuf) - 1] = '\0';
-	PlayerParseLine(PipeBuf + PipeIdx, PipeCnt);
-	PipeIdx = 0;
-	PipeCnt = 0;
+	PipeCount += n;
+	PipeRingParse();
+    }
+}
+
+/**
+**	Wakeup player thread.
+*/
+static void PlayerWakeup(void)
+{
+    uint64_t value;
+
+    value = 1;
+    if (PlayerEventFd != -1
+	&& write(PlayerEventFd, &value, sizeof(value)) != sizeof(value)) {
+	Error(tr("play/player: wakeup failed: %s\n"), strerror(errno));
     }
 }
 
@@ -586,6 +1132,10 @@ void ExecPlayer(const char *filename)
     if (ConfigUseSlave) {
 	close(PipeIn[0]);
 	close(PipeOut[1]);
+	// commands are written by the player thread, it never blocks
+	fcntl(PipeIn[1], F_SETFL, fcntl(PipeIn[1], F_GETFL) | O_NONBLOCK);
+	// output is read until empty
+	fcntl(PipeOut[0], F_SETFL, fcntl(PipeOut[0], F_GETFL) | O_NONBLOCK);
     }
 
     printf("play: child %d\n", pid);
@@ -632,32 +1182,179 @@ int IsPlayerRunning(void)
     return 0;
 }
 
+    /// Maximal number of queued player commands.
+#define COMMAND_QUEUE_MAX 32
+
 /**
-**	Send command to player.
+**	Queued player command.
 */
-static void SendCommand(const char *format, ...)
+static struct __command_
 {
-    va_list va;
+    const char *Key;			///< coalesce key, NULL = none
+    int Length;				///< length of command text
+    char Text[256];			///< command text
+} CommandQueue[COMMAND_QUEUE_MAX];	///< commands to player
+
+static cMutex CommandMutex;		///< lock of command queue
+static int CommandHead;			///< first queued command
+static int CommandCount;		///< number of queued commands
+static int CommandWritten;		///< bytes written of first command
+static int CommandDrops;		///< number of dropped commands
+
+/**
+**	Reset command queue.
+*/
+static void CommandQueueReset(void)
+{
+    cMutexLock lock(&CommandMutex);
+
+    CommandHead = 0;
+    CommandCount = 0;
+    CommandWritten = 0;
+    CommandDrops = 0;
+}
+
+/**
+**	Queue command to player.
+**
+**	A command with a coalesce key replaces a queued command with the
+**	same key, which isn't written yet.  Only the latest value is sent.
+**	The player thread writes the queue, the caller never blocks.
+**
+**	@param key	coalesce key, NULL = never coalesce
+**	@param format	printf format of command
+**	@param va	arguments of format
+**
+**	@returns true if the command is queued.
+*/
+static int QueueCommand(const char *key, const char *format, va_list va)
+{
+    struct __command_ *command;
     char buf[256];
     int n;
+    int i;
 
     if (!PlayerPid) {
-	return;
+	return 0;
     }
     if (PipeIn[1] == -1) {
 	Error(tr("play: no pipe to send command available\n"));
-	return;
+	return 0;
     }
-    va_start(va, format);
     n = vsnprintf(buf, sizeof(buf), format, va);
-    va_end(va);
+    if (n >= (int)sizeof(buf)) {
+	Error(tr("play: command too long\n"));
+	return 0;
+    }
+
+    {
+	cMutexLock lock(&CommandMutex);
+
+	command = NULL;
+	if (key) {
+	    // first command may be partly written
+	    for (i = CommandWritten ? 1 : 0; i < CommandCount; ++i) {
+		struct __command_ *queued;
+
+		queued = &CommandQueue[(CommandHead + i) % COMMAND_QUEUE_MAX];
+		if (queued->Key == key) {
+		    command = queued;
+		    Debug(3, "play: coalesce '%.*s'\n", queued->Length - 1,
+			queued->Text);
+		    break;
+		}
+	    }
+	}
+	if (!command) {
+	    if (CommandCount == COMMAND_QUEUE_MAX) {
+		++CommandDrops;
+		Error(tr("play: command queue full, %d commands dropped\n"),
+		    CommandDrops);
+		return 0;
+	    }
+	    command =
+		&CommandQueue[(CommandHead + CommandCount) % COMMAND_QUEUE_MAX];
+	    ++CommandCount;
+	}
+	command->Key = key;
+	command->Length = n;
+	memcpy(command->Text, buf, n);
+
+	Debug(3, "play: send '%.*s' (%d queued, %d dropped)\n", n - 1, buf,
+	    CommandCount, CommandDrops);
+    }
+    PlayerWakeup();
+    return 1;
+}
 
-    Debug(3, "play: send '%.*s'\n", n - 1, buf);
+/**
+**	Write queued commands to the player.
+**
+**	Called by the player thread, the pipe is non-blocking.
+**
+**	@returns true if commands are still queued.
+*/
+static bool WriteCommands(void)
+{
+    cMutexLock lock(&CommandMutex);
 
-    // FIXME: poll pipe if ready
-    if (write(PipeIn[1], buf, n) != n) {
-	fprintf(stderr, "play: write failed\n");
+    while (CommandCount) {
+	struct __command_ *command;
+	int n;
+
+	command = &CommandQueue[CommandHead];
+	n = write(PipeIn[1], command->Text + CommandWritten,
+	    command->Length - CommandWritten);
+	if (n < 0) {
+	    if (errno == EAGAIN || errno == EINTR) {
+		break;			// pipe full, wait until writable
+	    }
+	    Error(tr("play: write failed: %s, %d commands dropped\n"),
+		strerror(errno), CommandCount);
+	    CommandDrops += CommandCount;
+	    CommandHead = 0;
+	    CommandCount = 0;
+	    CommandWritten = 0;
+	    break;
+	}
+	CommandWritten += n;
+	if (CommandWritten == command->Length) {
+	    CommandHead = (CommandHead + 1) % COMMAND_QUEUE_MAX;
+	    --CommandCount;
+	    CommandWritten = 0;
+	}
     }
+    return CommandCount;
+}
+
+/**
+**	Send command to player.
+**
+**	@returns true if the command is queued.
+*/
+static int SendCommand(const char *format, ...)
+{
+    va_list va;
+    int queued;
+
+    va_start(va, format);
+    queued = QueueCommand(NULL, format, va);
+    va_end(va);
+    return queued;
+}
+
+/**
+**	Send command to player, replacing a queued command of same key.
+**
+**	@param key	coalesce key, compared by address
+*/
+static void SendCoalescedCommand(const char *key, const char *format, ...)
+{
+    va_list va;
+
+    va_start(va, format);
+    QueueCommand(key, format, va);
+    va_end(va);
 }
 
 /**
@@ -686,7 +1383,8 @@ static void PlayerSendPause(void)
 static void PlayerSendSetSpeed(int speed)
 {
     if (ConfigUseSlave) {
-	SendCommand("pausing_keep speed_set %d\n", speed);
+	SendCoalescedCommand("speed_set", "pausing_keep speed_set %d\n",
+	    speed);
     }
 }
 
@@ -700,6 +1398,22 @@ static void PlayerSendSeek(int seconds)
     }
 }
 
+/**
+**	Send player query of position.
+**
+**	The player answers the queries in order, the n-th answer belongs to
+**	the n-th query, see PlayerInfo::TimePosAnswers.
+**
+**	@returns sequence number of the query, 0 if not sent.
+*/
+static int PlayerSendGetTimePos(void)
+{
+    if (ConfigUseSlave && SendCommand("pausing_keep get_time_pos\n")) {
+	return ++PlayerTimePosQueries;
+    }
+    return 0;
+}
+
 /**
 **	Send player volume.
 */
@@ -707,7 +1421,7 @@ static void PlayerSendVolume(void)
 {
     if (ConfigUseSlave) {
 	// FIXME: %.2f could have a problem with LANG
-	SendCommand("pausing_keep volume %.2f 1\n",
+	SendCoalescedCommand("volume", "pausing_keep volume %.2f 1\n",
 	    (PlayerVolume * 100.0) / 255);
     }
 }
@@ -734,6 +1448,7 @@ static void OsdClose(void)
     Debug(3, "play: %s\n", __FUNCTION__);
 
     VideoWindowHide();
+    // backing pixmap is kept, reopen uploads only changes
     VideoWindowClear();
 }
 
@@ -760,6 +1475,36 @@ void OsdDrawARGB(int x, int y, int w, int h, const uint8_t * argb)
     VideoDrawARGB(x, y, w, h, argb);
 }
 
+/**
+**	Release a rendered pixmap, after the video thread has drawn it.
+**
+**	@param opaque	rendered cPixmapMemory
+*/
+static void OsdReleasePixmap(void *opaque)
+{
+    delete(cPixmapMemory *) opaque;
+}
+
+/**
+**	Draw osd palette indexed bitmap area.
+*/
+static void OsdDrawIndexed(int x, int y, int w, int h, const uint8_t * index,
+    int stride, const uint32_t * palette, int colors)
+{
+    Debug(3, "play: %s %d,%d %d,%d %d colors\n", __FUNCTION__, x, y, w, h,
+	colors);
+
+    VideoDrawIndexed(x, y, w, h, index, stride, palette, colors);
+}
+
+/**
+**	Upload all osd pixmaps drawn since last flush.
+*/
+static void OsdFlush(void)
+{
+    VideoOsdFlush();
+}
+
 /// C plugin get osd size and ascpect
 extern void GetOsdSize(int *, int *, double *);
 
@@ -849,6 +1594,11 @@ extern "C" void FeedKeyPress(const char *keymap, const char *key, int repeat,
 */
 class cMyOsd:public cOsd
 {
+  private:
+    cVector < cPixmapMemory * >Rendered;	///< pixmaps rendered by flush
+    uint32_t *Staging;			///< argb staging surface of bitmaps
+    int StagingSize;			///< pixels in staging surface
+    void ComposeBitmaps(int, int, int, int);	///< compose bitmap areas
   public:
     static volatile char Dirty;		///< flag force redraw everything
 
@@ -896,6 +1646,8 @@ void cMyOsd::SetActive(bool on)
 cMyOsd::cMyOsd(int left, int top, uint level)
 :cOsd(left, top, level)
 {
+    Staging = NULL;
+    StagingSize = 0;
     /* FIXME: OsdWidth/OsdHeight not correct!
        Debug(3, "[play]%s: %dx%d+%d+%d, %d\n", __FUNCTION__, OsdWidth(),
        OsdHeight(), left, top, level);
@@ -914,6 +1666,67 @@ cMyOsd::~cMyOsd(void)
     Debug(3, "[play]%s:\n", __FUNCTION__);
     SetActive(false);
     // done by SetActive: OsdClose();
+    delete[]Staging;
+}
+
+/**
+**	Compose all bitmap areas inside a rectangle into the staging surface.
+**
+**	Areas are drawn in their order, a later area covers an earlier one.
+**	Pixels not covered by any area are transparent.
+**
+**	@param x	x-coordinate of rectangle on osd
+**	@param y	y-coordinate of rectangle on osd
+**	@param w	width of rectangle
+**	@param h	height of rectangle
+*/
+void cMyOsd::ComposeBitmaps(int x, int y, int w, int h)
+{
+    cBitmap *bitmap;
+    int i;
+
+    if (w * h > StagingSize) {
+	delete[]Staging;
+	Staging = new uint32_t[w * h];
+	StagingSize = w * h;
+    }
+    memset(Staging, 0, w * h * sizeof(*Staging));
+
+    for (i = 0; (bitmap = GetBitmap(i)); ++i) {
+	const tColor *colors;
+	int n;
+	int bx;
+	int by;
+	int x1;
+	int y1;
+	int x2;
+	int y2;
+	int j;
+
+	// intersection of area and rectangle
+	bx = Left() + bitmap->X0();
+	by = Top() + bitmap->Y0();
+	x1 = bx > x ? bx : x;
+	y1 = by > y ? by : y;
+	x2 = bx + bitmap->Width() < x + w ? bx + bitmap->Width() : x + w;
+	y2 = by + bitmap->Height() < y + h ? by + bitmap->Height() : y + h;
+	if (x1 >= x2 || y1 >= y2) {
+	    continue;
+	}
+	// expand index rows through the palette
+	colors = bitmap->Colors(n);
+	for (j = y1; j < y2; ++j) {
+	    const tIndex *src;
+	    uint32_t *dst;
+	    int k;
+
+	    src = bitmap->Data(x1 - bx, j - by);
+	    dst = Staging + (j - y) * w + x1 - x;
+	    for (k = 0; k < x2 - x1; ++k) {
+		dst[k] = colors[src[k]];
+	    }
+	}
+    }
 }
 
 /**
@@ -922,6 +1735,7 @@ cMyOsd::~cMyOsd(void)
 void cMyOsd::Flush(void)
 {
     cPixmapMemory *pm;
+    int i;
 
     if (!Active()) {
 	return;
@@ -929,78 +1743,106 @@ void cMyOsd::Flush(void)
 
     if (!IsTrueColor()) {		// work bitmap
 	cBitmap *bitmap;
-	int i;
-
-	// draw all bitmaps
+	cBitmap *single;
+	int width;
+	int height;
+	double video_aspect;
+	int n;
+	int x1;
+	int y1;
+	int x2;
+	int y2;
+
+	// dirty bounding box of all bitmaps on osd
+	single = NULL;
+	n = 0;
+	x1 = y1 = x2 = y2 = 0;
 	for (i = 0; (bitmap = GetBitmap(i)); ++i) {
-	    uint8_t *argb;
-	    int x;
-	    int y;
-	    int w;
-	    int h;
-	    int x1;
-	    int y1;
-	    int x2;
-	    int y2;
-
-	    // get dirty bounding box
+	    int bx1;
+	    int by1;
+	    int bx2;
+	    int by2;
+
 	    if (Dirty) {		// forced complete update
-		x1 = 0;
-		y1 = 0;
-		x2 = bitmap->Width() - 1;
-		y2 = bitmap->Height() - 1;
-	    } else if (!bitmap->Dirty(x1, y1, x2, y2)) {
+		bx1 = 0;
+		by1 = 0;
+		bx2 = bitmap->Width() - 1;
+		by2 = bitmap->Height() - 1;
+	    } else if (!bitmap->Dirty(bx1, by1, bx2, by2)) {
 		continue;		// nothing dirty continue
 	    }
-	    // convert and upload only dirty areas
-	    w = x2 - x1 + 1;
-	    h = y2 - y1 + 1;
-	    if (1) {			// just for the case it makes trouble
-		int width;
-		int height;
-		double video_aspect;
-
-		::GetOsdSize(&width, &height, &video_aspect);
-		if (w > width) {
-		    w = width;
-		    x2 = x1 + width - 1;
-		}
-		if (h > height) {
-		    h = height;
-		    y2 = y1 + height - 1;
-		}
-	    }
-#ifdef DEBUG
-	    if (w > bitmap->Width() || h > bitmap->Height()) {
-		esyslog(tr("[play]: dirty area too big\n"));
-		abort();
-	    }
-#endif
-	    argb = (uint8_t *) malloc(w * h * sizeof(uint32_t));
-	    for (y = y1; y <= y2; ++y) {
-		for (x = x1; x <= x2; ++x) {
-		    ((uint32_t *) argb)[x - x1 + (y - y1) * w] =
-			bitmap->GetColor(x, y);
-		}
+	    bx1 += Left() + bitmap->X0();
+	    by1 += Top() + bitmap->Y0();
+	    bx2 += Left() + bitmap->X0();
+	    by2 += Top() + bitmap->Y0();
+	    if (!n++) {
+		single = bitmap;
+		x1 = bx1;
+		y1 = by1;
+		x2 = bx2;
+		y2 = by2;
+		continue;
 	    }
-	    OsdDrawARGB(Left() + bitmap->X0() + x1, Top() + bitmap->Y0() + y1,
-		w, h, argb);
+	    x1 = bx1 < x1 ? bx1 : x1;
+	    y1 = by1 < y1 ? by1 : y1;
+	    x2 = bx2 > x2 ? bx2 : x2;
+	    y2 = by2 > y2 ? by2 : y2;
+	}
 
+	// clip to osd
+	::GetOsdSize(&width, &height, &video_aspect);
+	x1 = x1 < 0 ? 0 : x1;
+	y1 = y1 < 0 ? 0 : y1;
+	x2 = x2 >= width ? width - 1 : x2;
+	y2 = y2 >= height ? height - 1 : y2;
+
+	if (n == 1 && x1 <= x2 && y1 <= y2) {
+	    const tColor *colors;
+	    int count;
+
+	    // single area: expand index rows directly into the osd
+	    colors = single->Colors(count);
+	    OsdDrawIndexed(x1, y1, x2 - x1 + 1, y2 - y1 + 1,
+		single->Data(x1 - Left() - single->X0(),
+		    y1 - Top() - single->Y0()), single->Width(), colors,
+		count);
+	} else if (n > 1 && x1 <= x2 && y1 <= y2) {
+	    // more areas: compose them and upload once
+	    ComposeBitmaps(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
+	    OsdDrawARGB(x1, y1, x2 - x1 + 1, y2 - y1 + 1,
+		(const uint8_t *)Staging);
+	}
+	for (i = 0; (bitmap = GetBitmap(i)); ++i) {
 	    bitmap->Clean();
-	    // FIXME: reuse argb
-	    free(argb);
 	}
 	cMyOsd::Dirty = 0;
+	OsdFlush();
 	return;
     }
 
-    LOCK_PIXMAPS;
-    while ((pm = RenderPixmaps())) {
+    // only render under the lock, the rendered pixmaps are our own
+    {
+	LOCK_PIXMAPS;
+#ifdef DEBUG
+	cTimeMs lock_time;
+#endif
+
+	while ((pm = RenderPixmaps())) {
+	    Rendered.Append(pm);
+	}
+#ifdef DEBUG
+	Debug(3, "[play]%s: pixmaps locked %d ms for %d pixmaps\n",
+	    __FUNCTION__, (int)lock_time.Elapsed(), Rendered.Size());
+#endif
+    }
+
+    for (i = 0; i < Rendered.Size(); ++i) {
 	int x;
 	int y;
 	int w;
 	int h;
 
+	pm = Rendered[i];
 	x = Left() + pm->ViewPort().X();
 	y = Top() + pm->ViewPort().Y();
 	w = pm->ViewPort().Width();
@@ -1011,10 +1853,11 @@ void cMyOsd::Flush(void)
 	   x, y, pm->Data());
 	 */
 
-	OsdDrawARGB(x, y, w, h, pm->Data());
-
-	delete pm;
+	// pixmap is handed over, deleted by the video thread
+	VideoDrawARGBImage(x, y, w, h, pm->Data(), OsdReleasePixmap, pm);
     }
+    Rendered.Clear();
+    OsdFlush();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1099,8 +1942,7 @@ cMyPlayer::cMyPlayer(const char *filename)
 {
     Debug(3, "play/%s: '%s'\n", __FUNCTION__, filename);
 
-    PipeCnt = 0;
-    PipeIdx = 0;
+    PipeRingExit();
 
     PipeIn[0] = -1;
     PipeIn[1] = -1;
@@ -1110,12 +1952,23 @@ cMyPlayer::cMyPlayer(const char *filename)
 
     PlayerPaused = 0;
     PlayerSpeed = 1;
+    PlayerTimePosQueries = 0;
 
-    DvdNav = 0;
+    PlayerParseInit();
+    {
+	cMutexLock lock(&StreamInfoMutex);
+
+	memset(&StreamInfo, 0, sizeof(StreamInfo));
+    }
+    CommandQueueReset();
 
     PlayerVolume = cDevice::CurrentVolume();
     Debug(3, "play: initial volume %d\n", PlayerVolume);
 
+    if ((PlayerEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+	Error(tr("play: eventfd failed: %s\n"), strerror(errno));
+    }
+
     FileName = strdup(filename);
 }
 
@@ -1154,13 +2007,21 @@ cMyPlayer::~cMyPlayer()
     }
     PlayerPid = 0;
 
+    // stop running, wakeup the blocked thread, then wait for it
+    Cancel(-1);
+    PlayerWakeup();
     Cancel(2);
+    if (PlayerEventFd != -1) {
+	close(PlayerEventFd);
+	PlayerEventFd = -1;
+    }
 
     if (ConfigOsdOverlay) {
 	DisableDummyDevice();
 	VideoExit();
     }
     ClosePipes();
+    PipeRingExit();
     free(FileName);
 }
 
@@ -1174,6 +2035,8 @@ void cMyPlayer::Activate(bool on)
     if (on) {
 	if (ConfigOsdOverlay) {
 	    VideoSetColorKey(ConfigColorKey);
+	    VideoSetArgb(ConfigOsdArgb);
+	    VideoSetShape(ConfigOsdShape);
 	    VideoInit(ConfigX11Display);
 	    EnableDummyDevice();
 	}
@@ -1199,19 +2062,70 @@ bool cMyPlayer::GetReplayMode(bool & play, bool & forward, int &speed)
 
 /**
 **	Thread action.
+**
+**	Sleeps until the player writes output, queued commands can be
+**	written or the thread is woken up.
+**	X11 events are handled by the video thread, its connection isn't
+**	polled here.
 */
 void cMyPlayer::Action(void)
 {
     Debug(3, "play: player thread started\n");
     while (Running()) {
-	if (ConfigUseSlave) {
-	    PollPipe();
-	    // FIXME: wait only if pipe not ready
+	pollfd poll_fds[3];
+	int n;
+
+	n = 0;
+	if (PlayerEventFd != -1) {
+	    poll_fds[n].fd = PlayerEventFd;
+	    poll_fds[n].events = POLLIN;
+	    poll_fds[n].revents = 0;
+	    ++n;
 	}
-	if (ConfigOsdOverlay) {
-	    VideoPollEvents(10);
-	} else {
+	if (ConfigUseSlave && PipeOut[0] != -1) {
+	    poll_fds[n].fd = PipeOut[0];
+	    poll_fds[n].events = POLLIN;
+	    poll_fds[n].revents = 0;
+	    ++n;
+	}
+	// wait for writable pipe only with pending commands
+	if (ConfigUseSlave && PipeIn[1] != -1 && WriteCommands()) {
+	    poll_fds[n].fd = PipeIn[1];
+	    poll_fds[n].events = POLLOUT;
+	    poll_fds[n].revents = 0;
+	    ++n;
+	}
+	if (!n) {			// nothing to wait for
 	    usleep(10 * 1000);
+	    continue;
+	}
+
+	if (poll(poll_fds, n, -1) < 0) {
+	    if (errno != EINTR) {
+		Error(tr("play/player: poll failed: %s\n"), strerror(errno));
+	    }
+	    continue;
+	}
+	for (--n; n >= 0; --n) {
+	    if (!poll_fds[n].revents) {
+		continue;
+	    }
+	    if (poll_fds[n].fd == PlayerEventFd) {
+		uint64_t value;
+
+		// reset wakeup counter
+		if (read(PlayerEventFd, &value, sizeof(value)) < 0
+		    && errno != EAGAIN) {
+		    Error(tr("play/player: read failed: %s\n"),
+			strerror(errno));
+		}
+	    } else if (poll_fds[n].fd == PipeIn[1]) {
+		// written on next loop
+	    } else if (!ReadPipe()) {	// player closed its output
+		Debug(3, "play: player output closed\n");
+		close(PipeOut[0]);
+		PipeOut[0] = -1;
+	    }
 	}
     }
     Debug(3, "play: player thread stopped\n");
@@ -1270,11 +2184,30 @@ bool cMyStatus::GetVolume(int &volume, bool &mute)
 //	cControl
 //////////////////////////////////////////////////////////////////////////////
 
+    /// Collect seek keys for this time in ms, before seeking.
+#define SEEK_DEBOUNCE_MS 400
+    /// Show progress for this time in ms, after last seek key.
+#define SEEK_SHOW_MS 2000
+
 class cMyControl:public cControl
 {
   private:
     cMyPlayer * Player;			///< our player
     cSkinDisplayReplay *Display;	///< our osd display
+    PlayerInfo Info;			///< copy of stream metadata
+    int SeekDelta;			///< accumulated seek seconds
+    cTimeMs SeekTimer;			///< debounce of seek keys
+    cTimeMs SeekShowTimer;		///< hide progress of seek
+    bool SeekShown;			///< progress display opened by seek
+    bool SeekFast;			///< fast response requested by seek
+    bool SeekResync;			///< seek sent, player not yet answered
+    int SeekTarget;			///< position of sent seek
+    int SeekQuery;			///< position query sent after seek
+    int ShownCurrent;			///< last shown position
+    int ShownTotal;			///< last shown length
+    int SeekBase(void) const;		///< position seek is relative to
+    void Seek(int);			///< accumulate relative seek
+    void SeekFlush(void);		///< send accumulated seek
     void ShowReplayMode(void);		///< display replay mode
     void ShowProgress(void);		///< display progress bar
     virtual void Show(void);		///< show replay control
@@ -1311,11 +2244,107 @@ void cMyControl::ShowReplayMode(void)
     }
 }
 
+/**
+**	Format seconds as h:mm:ss.
+*/
+static void FormatTime(char *buf, size_t size, int seconds)
+{
+    snprintf(buf, size, "%d:%02d:%02d", seconds / 3600, seconds / 60 % 60,
+	seconds % 60);
+}
+
+/**
+**	Position the accumulated seek is relative to.
+**
+**	The target of the sent seek, until the player answered the real
+**	position.
+*/
+int cMyControl::SeekBase(void) const
+{
+    return SeekResync ? SeekTarget : Info.TimePos;
+}
+
 /**
 **	Show progress.
+**
+**	The display is only flushed, if the shown values changed.
 */
 void cMyControl::ShowProgress(void)
 {
+    char buf[32];
+    int current;
+    int total;
+
+    if (!Display) {
+	return;
+    }
+    total = Info.Length;
+    current = SeekBase() + SeekDelta;
+    if (total > 0 && current > total) {
+	current = total;
+    }
+    if (current < 0) {
+	current = 0;
+    }
+    if (current == ShownCurrent && total == ShownTotal) {
+	return;
+    }
+    ShownCurrent = current;
+    ShownTotal = total;
+
+    if (total > 0) {
+	Display->SetProgress(current, total);
+	FormatTime(buf, sizeof(buf), total);
+	Display->SetTotal(buf);
+    }
+    FormatTime(buf, sizeof(buf), current);
+    Display->SetCurrent(buf);
+    Display->Flush();
+}
+
+/**
+**	Accumulate relative seek.
+**
+**	Repeated skip keys are collected and sent as a single seek, when no
+**	further key came for SEEK_DEBOUNCE_MS.
+**
+**	@param seconds	relative seek in seconds
+*/
+void cMyControl::Seek(int seconds)
+{
+    if (!SeekDelta && !SeekResync) {
+	// new seek: position answer arrives before the seek is sent
+	PlayerSendGetTimePos();
+    }
+    SeekDelta += seconds;
+    SeekTimer.Set(SEEK_DEBOUNCE_MS);
+    SeekShowTimer.Set(SEEK_SHOW_MS);
+    SeekFast = true;
+    SetNeedsFastResponse(true);		// timer is checked with kNone
+
+    if (!Display) {
+	Display = Skins.Current()->DisplayReplay(false);
+	SeekShown = true;
+    }
+    ShowProgress();
+}
+
+/**
+**	Send accumulated seek and resync with the player position.
+*/
+void cMyControl::SeekFlush(void)
+{
+    Debug(3, "play: seek %+d\n", SeekDelta);
+    PlayerSendSeek(SeekDelta);
+    // show target until the player answers the real position
+    SeekTarget = SeekBase() + SeekDelta;
+    if (SeekTarget < 0) {
+	SeekTarget = 0;
+    }
+    SeekDelta = 0;
+    // first answer after the seek is the new position
+    SeekQuery = PlayerSendGetTimePos();
+    SeekResync = SeekQuery != 0;
 }
 
 /**
@@ -1324,6 +2353,7 @@ void cMyControl::ShowProgress(void)
 void cMyControl::Show(void)
 {
     Debug(3, "%s:\n", __FUNCTION__);
+    GetPlayerInfo(&Info);
     if (!Display) {
 	ShowProgress();
     }
@@ -1338,6 +2368,15 @@ cMyControl::cMyControl(const char *filename)
 :  cControl(Player = new cMyPlayer(filename))
 {
     Display = NULL;
+    memset(&Info, 0, sizeof(Info));
+    SeekDelta = 0;
+    SeekShown = false;
+    SeekFast = false;
+    SeekResync = false;
+    SeekTarget = 0;
+    SeekQuery = 0;
+    ShownCurrent = -1;
+    ShownTotal = -1;
     Status = new cMyStatus;		// start monitoring volume
 
     //LastSkipKey = kNone;
@@ -1375,6 +2414,8 @@ void cMyControl::Hide(void)
 	delete Display;
 
 	Display = NULL;
+	SeekShown = false;
+	ShownCurrent = -1;
 	SetNeedsFastResponse(false);
     }
 }
@@ -1384,16 +2425,36 @@ eOSState cMyControl::ProcessKey(eKeys key)
     eOSState state;
 
     Debug(4, "%s: %d\n", __FUNCTION__, key);
+    GetPlayerInfo(&Info);
     if (!IsPlayerRunning()) {
 	Hide();
 	//Stop();
 	return osEnd;
     }
+    // send collected seek keys, hide progress shown by seek
+    if (SeekDelta && SeekTimer.TimedOut()) {
+	SeekFlush();
+    }
+    if (SeekResync && Info.TimePosAnswers - SeekQuery >= 0) {
+	SeekResync = false;
+    }
+    if (SeekFast) {
+	ShowProgress();
+	if (!SeekDelta && SeekShowTimer.TimedOut()) {
+	    SeekFast = false;
+	    SeekResync = false;
+	    if (SeekShown) {
+		Hide();
+	    } else {
+		SetNeedsFastResponse(false);
+	    }
+	}
+    }
     //state=cOsdMenu::ProcessKey(key);
     state = osContinue;
     switch ((int)key) {			// cast to shutup g++ warnings
 	case kUp:
-	    if (DvdNav) {
+	    if (Info.DvdNav) {
 		SendCommand("pausing_keep dvdnav up\n");
 		break;
 	    }
@@ -1410,7 +2471,7 @@ eOSState cMyControl::ProcessKey(eKeys key)
 	    break;
 
 	case kDown:
-	    if (DvdNav) {
+	    if (Info.DvdNav) {
 		SendCommand("pausing_keep dvdnav down\n");
 		break;
 	    }
@@ -1428,7 +2489,7 @@ eOSState cMyControl::ProcessKey(eKeys key)
 	    // FIXME:
 	    break;
 	case kLeft:
-	    if (DvdNav) {
+	    if (Info.DvdNav) {
 		SendCommand("pausing_keep dvdnav left\n");
 		break;
 	    }
@@ -1436,12 +2497,12 @@ eOSState cMyControl::ProcessKey(eKeys key)
 	    if (PlayerSpeed > 1) {
 		PlayerSendSetSpeed(PlayerSpeed /= 2);
 	    } else {
-		PlayerSendSeek(-10);
+		Seek(-10);
 	    }
 	    ShowReplayMode();
 	    break;
 	case kRight:
-	    if (DvdNav) {
+	    if (Info.DvdNav) {
 		SendCommand("pausing_keep dvdnav right\n");
 		break;
 	    }
@@ -1458,44 +2519,44 @@ eOSState cMyControl::ProcessKey(eKeys key)
 
 #ifdef USE_JUMPINGSECONDS
 	case kGreen|k_Repeat:
-	    PlayerSendSeek(-Setup.JumpSecondsRepeat);
+	    Seek(-Setup.JumpSecondsRepeat);
 	    break;
 	case kGreen:
-	    PlayerSendSeek(-Setup.JumpSeconds);
+	    Seek(-Setup.JumpSeconds);
 	    break;
 	case k1|k_Repeat:
 	case k1:
-	    PlayerSendSeek(-Setup.JumpSecondsSlow);
+	    Seek(-Setup.JumpSecondsSlow);
 	    break;
 	case k3|k_Repeat:
 	case k3:
-	    PlayerSendSeek( Setup.JumpSecondsSlow);
+	    Seek(Setup.JumpSecondsSlow);
 	    break;
 	case kYellow|k_Repeat:
-	    PlayerSendSeek(Setup.JumpSecondsRepeat);
+	    Seek(Setup.JumpSecondsRepeat);
 	    break;
 	case kYellow:
-	    PlayerSendSeek(Setup.JumpSeconds);
+	    Seek(Setup.JumpSeconds);
 	    break;
 #else
 	case kGreen|k_Repeat:
 	case kGreen:
-	    PlayerSendSeek(-60); 
+	    Seek(-60);
 	    break;
 	case kYellow|k_Repeat:
 	case kYellow:
-	    PlayerSendSeek(+60);
+	    Seek(+60);
 	    break;
 #endif /* JUMPINGSECONDS */
 #ifdef USE_LIEMIKUUTIO
 #ifndef USE_JUMPINGSECONDS
 	case k1|k_Repeat:
 	case k1:
-	    PlayerSendSeek(-20);
+	    Seek(-20);
 	    break;
 	case k3|k_Repeat:
 	case k3:
-	    PlayerSendSeek(+20);
+	    Seek(+20);
 	    break;
 #endif /* JUMPINGSECONDS */
 #endif
@@ -1507,9 +2568,9 @@ eOSState cMyControl::ProcessKey(eKeys key)
 	    return osEnd;
 
 	case kOk:
-	    if (DvdNav) {
+	    if (Info.DvdNav) {
 		SendCommand("pausing_keep dvdnav select\n");
-		// FIXME: DvdNav = 0;
+		// FIXME: Info.DvdNav = 0;
 		break;
 	    }
 	    // FIXME: full mode
@@ -1517,7 +2578,7 @@ eOSState cMyControl::ProcessKey(eKeys key)
 	    break;
 
 	case kBack:
-	    if (DvdNav > 1) {
+	    if (Info.DvdNav > 1) {
 		SendCommand("pausing_keep dvdnav prev\n");
 		break;
 	    }
@@ -1527,7 +2588,7 @@ eOSState cMyControl::ProcessKey(eKeys key)
 	    return osBack;
 
 	case kMenu:
-	    if (DvdNav) {
+	    if (Info.DvdNav) {
 		SendCommand("pausing_keep dvdnav menu\n");
 		break;
 	    }
@@ -45,6 +45,7 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include <xcb/xcb.h>
+#include <xcb/xcbext.h>
 #include <xcb/xcb_icccm.h>
 #include <xcb/xcb_image.h>
 #include <xcb/xcb_pixel.h>
@@ -53,6 +54,14 @@
 #include <X11/keysym.h>			// keysym XK_
 #include <X11/XF86keysym.h>		// XF86XK_
 #include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/uio.h>
+#include <xcb/shm.h>
+#include <xcb/render.h>
+#include <xcb/shape.h>
 
 static xcb_connection_t *Connection;	///< xcb connection
 static xcb_colormap_t VideoColormap;	///< video colormap
@@ -65,36 +74,99 @@ static xcb_cursor_t VideoBlankCursor;	///< empty invisible cursor
 
 static uint32_t VideoColorKey;		///< color key pixel value
 
+static char VideoArgb;			///< flag osd uses argb visual
+static xcb_visualid_t VideoOsdVisual;	///< visual of osd window
+static uint8_t VideoOsdDepth;		///< depth of osd window
+static xcb_colormap_t VideoOsdColormap;	///< colormap of argb osd window
+static uint32_t VideoOsdKey;		///< transparent osd pixel, xrgb
+static uint32_t VideoOsdKeyPixel;	///< transparent osd pixel, native
+static char VideoShape;			///< flag osd transparency by shape
+static xcb_rectangle_t *VideoShapeRects;	///< opaque areas of shape
+static int VideoShapeSize;		///< allocated shape rectangles
+static xcb_render_pictformat_t VideoOsdFormat;	///< picture format of osd
+static xcb_render_picture_t VideoPixmapPicture;	///< picture of osd pixmap
+static xcb_render_picture_t VideoOsdPicture;	///< picture of osd window
+
+static uint8_t VideoBitsPerPixel;	///< bits per pixel of osd depth
+static uint8_t VideoByteOrder;		///< image byte order of server
+static uint8_t VideoScanlinePad;	///< scanline pad of osd depth
+static uint32_t VideoRedMask;		///< red mask of osd visual
+static uint32_t VideoGreenMask;		///< green mask of osd visual
+static uint32_t VideoBlueMask;		///< blue mask of osd visual
+
+static xcb_gcontext_t VideoOsdGC;	///< graphic context of osd window
+static size_t VideoMaxRequestBytes;	///< maximal request length of server
+static uint8_t *VideoImageData;		///< reusable image buffer
+static size_t VideoImageSize;		///< size of reusable image buffer
+
+static xcb_shm_seg_t VideoShmSeg;	///< shared memory segment of osd
+static uint8_t *VideoShmData;		///< shared memory osd image
+static char VideoShmPending;		///< server may still read the segment
+
+static uint8_t *VideoOsdSurface;	///< osd window image, native format
+static unsigned VideoOsdStride;		///< bytes per row of osd surface
+
+    /// Width and height of osd surface tiles.
+#define VIDEO_TILE_SIZE 32
+
+static uint64_t *VideoTileHash;		///< content hash of uploaded tiles
+static unsigned VideoTilesX;		///< number of tile columns
+static unsigned VideoTilesY;		///< number of tile rows
+
+///
+///	Solid filled area of osd surface.
+///
+typedef struct _video_osd_fill_
+{
+    xcb_rectangle_t Rect;		///< filled area
+    uint32_t Pixel;			///< native pixel value of area
+} VideoOsdFill;
+
+static VideoOsdFill *VideoFills;	///< solid areas of next upload
+static int VideoFillN;			///< number of solid areas
+static uint32_t VideoOsdForeground;	///< foreground pixel of osd gc
+static char VideoOsdMapPending;		///< map osd window after upload
+
+static xcb_pixmap_t VideoOsdPixmap;	///< backing store of osd window
+
+    /// Maximal number of damaged rectangles per flush.
+#define VIDEO_DAMAGE_MAX 16
+
+static xcb_rectangle_t VideoDamage[VIDEO_DAMAGE_MAX];	///< damaged areas
+static int VideoDamageN;		///< number of damaged areas
+
 static int VideoWindowX;		///< video output window x coordinate
 static int VideoWindowY;		///< video outout window y coordinate
 static unsigned VideoWindowWidth;	///< video output window width
 static unsigned VideoWindowHeight;	///< video output window height
+static unsigned VideoOsdWidth;		///< osd width, fixed or window width
+static unsigned VideoOsdHeight;		///< osd height, fixed or window height
+static unsigned VideoConfigOsdWidth;	///< fixed osd width, 0 = window
+static unsigned VideoConfigOsdHeight;	///< fixed osd height, 0 = window
+static char VideoOsdScaled;		///< flag osd is scaled into window
 
 ///
 ///	Create X11 window.
 ///
 ///	@param parent	parent of new window
-///	@param visual	visual of parent
-///	@param depth	depth of parent
+///	@param visual	visual of new window
+///	@param depth	depth of new window
+///	@param colormap	colormap matching @p visual
+///	@param background	background and border pixel value
+///	@param override_redirect	top-level window not managed by the
+///		window manager, stacked above all windows
 ///
 ///	@returns created X11 window id
 ///
 static xcb_window_t VideoCreateWindow(xcb_window_t parent,
-    xcb_visualid_t visual, uint8_t depth)
+    xcb_visualid_t visual, uint8_t depth, xcb_colormap_t colormap,
+    uint32_t background, int override_redirect)
 {
-    uint32_t values[5];
+    uint32_t values[6];
     xcb_window_t window;
 
     Debug(3, "video: visual %#0x depth %d\n", visual, depth);
 
-    //
-    // create color map
-    //
-    if (VideoColormap == XCB_NONE) {
-	VideoColormap = xcb_generate_id(Connection);
-	xcb_create_colormap(Connection, XCB_COLORMAP_ALLOC_NONE, VideoColormap,
-	    parent, visual);
-    }
     //
     //	create blank cursor
     //
@@ -107,21 +179,22 @@ static xcb_window_t VideoCreateWindow(xcb_window_t parent,
 	VideoBlankTick = 0;
     }
 
-    values[0] = VideoColorKey;		// ARGB
-    values[1] = VideoColorKey;
-    values[2] =
+    values[0] = background;		// ARGB
+    values[1] = background;
+    values[2] = override_redirect != 0;
+    values[3] =
 	XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE |
 	XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE |
 	XCB_EVENT_MASK_POINTER_MOTION | XCB_EVENT_MASK_EXPOSURE |
 	XCB_EVENT_MASK_STRUCTURE_NOTIFY;
-    values[3] = VideoColormap;
-    values[4] = VideoBlankCursor;
+    values[4] = colormap;
+    values[5] = VideoBlankCursor;
     window = xcb_generate_id(Connection);
     xcb_create_window(Connection, depth, window, parent, VideoWindowX,
 	VideoWindowY, VideoWindowWidth, VideoWindowHeight, 0,
 	XCB_WINDOW_CLASS_INPUT_OUTPUT, visual,
-	XCB_CW_BACK_PIXEL | XCB_CW_BORDER_PIXEL | XCB_CW_EVENT_MASK |
-	XCB_CW_COLORMAP | XCB_CW_CURSOR, values);
+	XCB_CW_BACK_PIXEL | XCB_CW_BORDER_PIXEL | XCB_CW_OVERRIDE_REDIRECT |
+	XCB_CW_EVENT_MASK | XCB_CW_COLORMAP | XCB_CW_CURSOR, values);
 
     // define only available with xcb-utils-0.3.8
 #ifdef XCB_ICCCM_NUM_WM_SIZE_HINTS_ELEMENTS
@@ -142,6 +215,12 @@ static xcb_window_t VideoCreateWindow(xcb_window_t parent,
 
     // FIXME: size hints
 
+    if (override_redirect) {		// above all windows
+	values[0] = XCB_STACK_MODE_ABOVE;
+	xcb_configure_window(Connection, window, XCB_CONFIG_WINDOW_STACK_MODE,
+	    values);
+	return window;
+    }
     // window above parent
     values[0] = parent;
     values[1] = XCB_STACK_MODE_ABOVE;
@@ -151,117 +230,2038 @@ static xcb_window_t VideoCreateWindow(xcb_window_t parent,
     return window;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+//	Pixel conversion
+//////////////////////////////////////////////////////////////////////////////
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+    /// Pixels with an alpha below this value become the color key.
+#define VIDEO_ALPHA_THRESHOLD 200
+
+    /// Typedef of convert ARGB row to osd pixels function.
+typedef void VideoConvertRowFunc(uint32_t *, const uint32_t *, int,
+    uint32_t);
+
 ///
-///	Draw a ARGB image.
+///	Convert an ARGB pixel to a XRGB pixel with color key.
 ///
-///	@param x	x position of image in osd
-///	@param y	y position of image in osd
-///	@param width	width of image
-///	@param height	height of image
-///	@param argb	argb image
+///	@param pixel	ARGB pixel
+///	@param key	color key pixel value
 ///
-void VideoDrawARGB(int x, int y, int width, int height, const uint8_t * argb)
+static inline uint32_t VideoPixelColorKey(uint32_t pixel, uint32_t key)
 {
-    xcb_image_t *xcb_image;
-    xcb_gcontext_t gc;
-    int sx;
-    int sy;
+    return (pixel >> 24) < VIDEO_ALPHA_THRESHOLD ? key : pixel & 0x00FFFFFF;
+}
 
-    if (!Connection) {
-	Debug(3, "play: FIXME: must restore osd provider\n");
-	return;
+///
+///	Convert an ARGB pixel to a premultiplied ARGB pixel.
+///
+///	@param pixel	ARGB pixel
+///	@param key	unused, alpha is kept
+///
+static inline uint32_t VideoPixelPremultiply(uint32_t pixel,
+    __attribute__ ((unused)) uint32_t key)
+{
+    uint32_t alpha;
+    uint32_t rb;
+    uint32_t g;
+
+    alpha = pixel >> 24;
+    if (alpha == 0xFF) {
+	return pixel;
     }
+    // red and blue together, x * a / 255 rounded
+    rb = (pixel & 0x00FF00FF) * alpha + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    g = (pixel & 0x0000FF00) * alpha + 0x00008000;
+    g = ((g + ((g >> 8) & 0x0000FF00)) >> 8) & 0x0000FF00;
+    return (alpha << 24) | rb | g;
+}
 
-    gc = xcb_generate_id(Connection);
-    xcb_create_gc(Connection, gc, VideoOsdWindow, 0, NULL);
+///
+///	Convert a row of ARGB pixels to XRGB pixels with color key.
+///
+///	Generic C version.
+///
+///	@param dst	output XRGB pixels
+///	@param src	input ARGB pixels
+///	@param n	number of pixels in row
+///	@param key	color key pixel value
+///
+static void VideoConvertRowC(uint32_t * dst, const uint32_t * src, int n,
+    uint32_t key)
+{
+    int i;
 
-    xcb_image =
-	xcb_image_create_native(Connection, width, height,
-	XCB_IMAGE_FORMAT_Z_PIXMAP, VideoScreen->root_depth, NULL, 0L, NULL);
+    for (i = 0; i < n; ++i) {
+	dst[i] = VideoPixelColorKey(src[i], key);
+    }
+}
 
-    //	fast 32it versions
-    if (xcb_image->bpp == 32) {
-	if (xcb_image->byte_order == XCB_IMAGE_ORDER_LSB_FIRST) {
-	    for (sy = 0; sy < height; ++sy) {
-		for (sx = 0; sx < width; ++sx) {
-		    uint32_t pixel;
+#if defined(__x86_64__) || defined(__i386__)
 
-		    if (argb[(width * sy + sx) * 4 + 3] < 200) {
-			pixel = VideoColorKey;
-		    } else {
-			pixel = argb[(width * sy + sx) * 4 + 0] << 0;
-			pixel |= argb[(width * sy + sx) * 4 + 1] << 8;
-			pixel |= argb[(width * sy + sx) * 4 + 2] << 16;
-		    }
-		    xcb_image_put_pixel_Z32L(xcb_image, sx, sy, pixel);
-		}
-	    }
-	} else {
-	    Error(_("play: unsupported put_image\n"));
-	}
-    } else {
-	for (sy = 0; sy < height; ++sy) {
-	    for (sx = 0; sx < width; ++sx) {
-		uint32_t pixel;
-
-		if (argb[(width * sy + sx) * 4 + 3] < 200) {
-		    pixel = argb[(width * sy + sx) * 4 + 3] << 0;
-		    pixel |= argb[(width * sy + sx) * 4 + 3] << 8;
-		    pixel |= argb[(width * sy + sx) * 4 + 3] << 16;
-		} else {
-		    pixel = argb[(width * sy + sx) * 4 + 0] << 0;
-		    pixel |= argb[(width * sy + sx) * 4 + 1] << 8;
-		    pixel |= argb[(width * sy + sx) * 4 + 2] << 16;
-		}
-		xcb_image_put_pixel(xcb_image, sx, sy, pixel);
-	    }
-	}
+///
+///	Convert a row of ARGB pixels to XRGB pixels with color key.
+///
+///	SSE2 version, 4 pixels per loop.
+///
+///	@param dst	output XRGB pixels
+///	@param src	input ARGB pixels
+///	@param n	number of pixels in row
+///	@param key	color key pixel value
+///
+__attribute__ ((target("sse2")))
+static void VideoConvertRowSSE2(uint32_t * dst, const uint32_t * src, int n,
+    uint32_t key)
+{
+    const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i color_key = _mm_set1_epi32(key);
+    const __m128i threshold = _mm_set1_epi32(VIDEO_ALPHA_THRESHOLD);
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+	__m128i pixel;
+	__m128i transparent;
+
+	pixel = _mm_loadu_si128((const __m128i *)(src + i));
+	// alpha is 0-255, signed compare is fine
+	transparent = _mm_cmplt_epi32(_mm_srli_epi32(pixel, 24), threshold);
+	pixel =
+	    _mm_or_si128(_mm_and_si128(transparent, color_key),
+	    _mm_andnot_si128(transparent, _mm_and_si128(pixel, rgb_mask)));
+	_mm_storeu_si128((__m128i *) (dst + i), pixel);
     }
+    VideoConvertRowC(dst + i, src + i, n - i, key);
+}
 
-    // render xcb_image to color data pixmap
-    xcb_image_put(Connection, VideoOsdWindow, gc, xcb_image, x, y, 0);
-    // release xcb_image
-    xcb_image_destroy(xcb_image);
-    xcb_free_gc(Connection, gc);
-    xcb_flush(Connection);
+///
+///	Convert a row of ARGB pixels to XRGB pixels with color key.
+///
+///	AVX2 version, 8 pixels per loop.
+///
+///	@param dst	output XRGB pixels
+///	@param src	input ARGB pixels
+///	@param n	number of pixels in row
+///	@param key	color key pixel value
+///
+__attribute__ ((target("avx2")))
+static void VideoConvertRowAVX2(uint32_t * dst, const uint32_t * src, int n,
+    uint32_t key)
+{
+    const __m256i rgb_mask = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i color_key = _mm256_set1_epi32(key);
+    const __m256i threshold = _mm256_set1_epi32(VIDEO_ALPHA_THRESHOLD);
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+	__m256i pixel;
+	__m256i transparent;
+
+	pixel = _mm256_loadu_si256((const __m256i *)(src + i));
+	transparent =
+	    _mm256_cmpgt_epi32(threshold, _mm256_srli_epi32(pixel, 24));
+	pixel =
+	    _mm256_blendv_epi8(_mm256_and_si256(pixel, rgb_mask), color_key,
+	    transparent);
+	_mm256_storeu_si256((__m256i *) (dst + i), pixel);
+    }
+    VideoConvertRowSSE2(dst + i, src + i, n - i, key);
 }
 
+#endif
+
 ///
-///	Show window.
+///	Convert a row of ARGB pixels to premultiplied ARGB pixels.
 ///
-void VideoWindowShow(void)
+///	Used with the argb osd visual, XRender expects premultiplied
+///	colors.
+///
+///	@param dst	output premultiplied ARGB pixels
+///	@param src	input ARGB pixels
+///	@param n	number of pixels in row
+///	@param key	unused, alpha is kept
+///
+static void VideoConvertRowPremultiply(uint32_t * dst, const uint32_t * src,
+    int n, __attribute__ ((unused)) uint32_t key)
 {
-    if (!Connection) {
-	Debug(3, "play: FIXME: must restore osd provider\n");
+    int i;
+
+    for (i = 0; i < n; ++i) {
+	dst[i] = VideoPixelPremultiply(src[i], key);
+    }
+}
+
+    /// Convert ARGB row function, selected by cpu features.
+static VideoConvertRowFunc *VideoConvertRow = VideoConvertRowC;
+
+    /// Typedef of pack xrgb row into native image format function.
+typedef void VideoPackRowFunc(uint8_t *, const uint32_t *, int);
+
+///
+///	Scale a 8 bit color component to a visual color mask.
+///
+///	@param c	8 bit color component
+///	@param mask	color mask of visual
+///
+static uint32_t VideoPackComponent(uint32_t c, uint32_t mask)
+{
+    int shift;
+    int bits;
+
+    if (!mask) {
+	return 0;
+    }
+    shift = __builtin_ctz(mask);
+    bits = __builtin_popcount(mask);
+    if (bits <= 8) {
+	return (c >> (8 - bits)) << shift;
+    }
+    return (c << (bits - 8)) << shift;
+}
+
+///
+///	Convert a xrgb pixel to a pixel value of the osd visual.
+///
+///	@param xrgb	xrgb pixel
+///
+///	@returns native pixel value.
+///
+static uint32_t VideoNativePixel(uint32_t xrgb)
+{
+    if (VideoArgb) {			// a8r8g8b8 only
+	return xrgb;
+    }
+    return VideoPackComponent((xrgb >> 16) & 0xFF,
+	VideoRedMask) | VideoPackComponent((xrgb >> 8) & 0xFF,
+	VideoGreenMask) | VideoPackComponent(xrgb & 0xFF, VideoBlueMask);
+}
+
+///
+///	Store a pixel as 32 bit lsb first.
+///
+static inline void VideoStore32LSB(uint8_t * dst, uint32_t pixel)
+{
+    dst[0] = pixel;
+    dst[1] = pixel >> 8;
+    dst[2] = pixel >> 16;
+    dst[3] = pixel >> 24;
+}
+
+///
+///	Store a pixel as 32 bit msb first.
+///
+static inline void VideoStore32MSB(uint8_t * dst, uint32_t pixel)
+{
+    dst[0] = pixel >> 24;
+    dst[1] = pixel >> 16;
+    dst[2] = pixel >> 8;
+    dst[3] = pixel;
+}
+
+///
+///	Store a xrgb pixel as 24 bit lsb first.
+///
+static inline void VideoStore24LSB(uint8_t * dst, uint32_t pixel)
+{
+    dst[0] = pixel;
+    dst[1] = pixel >> 8;
+    dst[2] = pixel >> 16;
+}
+
+///
+///	Store a xrgb pixel as 24 bit msb first.
+///
+static inline void VideoStore24MSB(uint8_t * dst, uint32_t pixel)
+{
+    dst[0] = pixel >> 16;
+    dst[1] = pixel >> 8;
+    dst[2] = pixel;
+}
+
+///
+///	Reduce a xrgb pixel to RGB565.
+///
+static inline uint32_t VideoPixel565(uint32_t pixel)
+{
+    return ((pixel >> 8) & 0xF800) | ((pixel >> 5) & 0x07E0) | ((pixel >> 3)
+	& 0x001F);
+}
+
+///
+///	Store a xrgb pixel as RGB565 lsb first.
+///
+static inline void VideoStore565LSB(uint8_t * dst, uint32_t pixel)
+{
+    pixel = VideoPixel565(pixel);
+    dst[0] = pixel;
+    dst[1] = pixel >> 8;
+}
+
+///
+///	Store a xrgb pixel as RGB565 msb first.
+///
+static inline void VideoStore565MSB(uint8_t * dst, uint32_t pixel)
+{
+    pixel = VideoPixel565(pixel);
+    dst[0] = pixel >> 8;
+    dst[1] = pixel;
+}
+
+///
+///	Shifts of a xrgb color component into the osd visual.
+///
+typedef struct _video_generic_component_
+{
+    uint8_t Right;			///< right shift of xrgb component
+    uint8_t Left;			///< left shift into visual
+    uint32_t Mask;			///< mask of component after right shift
+} VideoGenericComponent;
+
+    /// Red, green and blue shifts of the generic pack, from VideoPackInit.
+static VideoGenericComponent VideoGenericShift[3];
+
+    /// Bytes per pixel of the generic pack, from VideoPackInit.
+static int VideoGenericBytes;
+
+///
+///	Precompute the shifts of a color component for the generic pack.
+///
+///	Same result as VideoPackComponent, without ctz/popcount per pixel.
+///
+///	@param[out] component	shifts of component
+///	@param xrgb_shift	position of the 8 bit component in xrgb
+///	@param mask		color mask of visual
+///
+static void VideoGenericComponentInit(VideoGenericComponent * component,
+    int xrgb_shift, uint32_t mask)
+{
+    int shift;
+    int bits;
+
+    if (!mask) {
+	component->Right = 0;
+	component->Left = 0;
+	component->Mask = 0;
 	return;
     }
-    xcb_map_window(Connection, VideoOsdWindow);
+    shift = __builtin_ctz(mask);
+    bits = __builtin_popcount(mask);
+    if (bits <= 8) {
+	component->Right = xrgb_shift + 8 - bits;
+	component->Left = shift;
+	component->Mask = (1 << bits) - 1;
+    } else {
+	component->Right = xrgb_shift;
+	component->Left = shift + bits - 8;
+	component->Mask = 0xFF;
+    }
 }
 
 ///
-///	Hide window.
+///	Convert a xrgb pixel with the precomputed generic shifts.
 ///
-void VideoWindowHide(void)
+static inline uint32_t VideoGenericPixel(uint32_t xrgb)
 {
-    if (!Connection) {
-	Debug(3, "play: FIXME: must restore osd provider\n");
+    return ((xrgb >> VideoGenericShift[0].Right) & VideoGenericShift[0].Mask)
+	<< VideoGenericShift[0].Left | ((xrgb >> VideoGenericShift[1].Right)
+	& VideoGenericShift[1].Mask) << VideoGenericShift[1].Left | ((xrgb >>
+	    VideoGenericShift[2].Right) & VideoGenericShift[2].Mask) <<
+	VideoGenericShift[2].Left;
+}
+
+///
+///	Store a xrgb pixel for any true color visual lsb first.
+///
+///	Generic slow version, uses the shifts precomputed from the color
+///	masks of the visual.
+///
+static inline void VideoStoreGenericLSB(uint8_t * dst, uint32_t pixel)
+{
+    int j;
+
+    pixel = VideoGenericPixel(pixel);
+    for (j = 0; j < VideoGenericBytes; ++j) {
+	dst[j] = pixel;
+	pixel >>= 8;
+    }
+}
+
+///
+///	Store a xrgb pixel for any true color visual msb first.
+///
+///	Generic slow version, uses the shifts precomputed from the color
+///	masks of the visual.
+///
+static inline void VideoStoreGenericMSB(uint8_t * dst, uint32_t pixel)
+{
+    int j;
+
+    pixel = VideoGenericPixel(pixel);
+    for (j = VideoGenericBytes - 1; j >= 0; --j) {
+	dst[j] = pixel;
+	pixel >>= 8;
+    }
+}
+
+///
+///	Define a pack xrgb row function for a pixel store.
+///
+///	@param name	function name
+///	@param store	pixel store function
+///	@param bytes	bytes per pixel, 0 = from image format
+///
+#define VIDEO_PACK_ROW(name, store, bytes) \
+static void name(uint8_t * dst, const uint32_t * src, int n) \
+{ \
+    const int step = (bytes) ? (bytes) : VideoGenericBytes; \
+    int i; \
+ \
+    for (i = 0; i < n; ++i) { \
+	store(dst, src[i]); \
+	dst += step; \
+    } \
+}
+
+VIDEO_PACK_ROW(VideoPackRow32MSB, VideoStore32MSB, 4)
+VIDEO_PACK_ROW(VideoPackRow24LSB, VideoStore24LSB, 3)
+VIDEO_PACK_ROW(VideoPackRow24MSB, VideoStore24MSB, 3)
+VIDEO_PACK_ROW(VideoPackRow565LSB, VideoStore565LSB, 2)
+VIDEO_PACK_ROW(VideoPackRow565MSB, VideoStore565MSB, 2)
+VIDEO_PACK_ROW(VideoPackRowGenericLSB, VideoStoreGenericLSB, 0)
+VIDEO_PACK_ROW(VideoPackRowGenericMSB, VideoStoreGenericMSB, 0)
+
+    /// Typedef of convert ARGB row into native image format function.
+typedef void VideoConvertPackRowFunc(uint8_t *, const uint32_t *, int,
+    uint32_t);
+
+///
+///	Define a convert ARGB row into native image format function.
+///
+///	Conversion and packing are fused into a single loop, the image
+///	format is fixed at compile time, no format branches per pixel.
+///
+///	@param name	function name
+///	@param convert	pixel conversion function (color key or premultiply)
+///	@param store	pixel store function
+///	@param bytes	bytes per pixel, 0 = from image format
+///
+#define VIDEO_CONVERT_PACK_ROW(name, convert, store, bytes) \
+static void name(uint8_t * dst, const uint32_t * src, int n, uint32_t key) \
+{ \
+    const int step = (bytes) ? (bytes) : VideoGenericBytes; \
+    int i; \
+ \
+    for (i = 0; i < n; ++i) { \
+	store(dst, convert(src[i], key)); \
+	dst += step; \
+    } \
+}
+
+VIDEO_CONVERT_PACK_ROW(VideoConvertPackRowKey32MSB, VideoPixelColorKey,
+    VideoStore32MSB, 4)
+VIDEO_CONVERT_PACK_ROW(VideoConvertPackRowKey24LSB, VideoPixelColorKey,
+    VideoStore24LSB, 3)
+VIDEO_CONVERT_PACK_ROW(VideoConvertPackRowKey24MSB, VideoPixelColorKey,
+    VideoStore24MSB, 3)
+VIDEO_CONVERT_PACK_ROW(VideoConvertPackRowKey565LSB, VideoPixelColorKey,
+    VideoStore565LSB, 2)
+VIDEO_CONVERT_PACK_ROW(VideoConvertPackRowKey565MSB, VideoPixelColorKey,
+    VideoStore565MSB, 2)
+VIDEO_CONVERT_PACK_ROW(VideoConvertPackRowKeyGenericLSB, VideoPixelColorKey,
+    VideoStoreGenericLSB, 0)
+VIDEO_CONVERT_PACK_ROW(VideoConvertPackRowKeyGenericMSB, VideoPixelColorKey,
+    VideoStoreGenericMSB, 0)
+VIDEO_CONVERT_PACK_ROW(VideoConvertPackRowPremultiply32LSB,
+    VideoPixelPremultiply, VideoStore32LSB, 4)
+VIDEO_CONVERT_PACK_ROW(VideoConvertPackRowPremultiply32MSB,
+    VideoPixelPremultiply, VideoStore32MSB, 4)
+
+///
+///	Convert ARGB row into 32 bit lsb first rgb888 pixels.
+///
+///	Uses the cpu selected color key row conversion directly.
+///
+///	@param dst	output image row
+///	@param src	input ARGB pixels
+///	@param n	number of pixels in row
+///	@param key	color key pixel value
+///
+static void VideoConvertPackRowKey32LSB(uint8_t * dst, const uint32_t * src,
+    int n, uint32_t key)
+{
+    VideoConvertRow((uint32_t *) dst, src, n, key);
+}
+
+    /// Convert ARGB row into native image format, selected by image format.
+static VideoConvertPackRowFunc *VideoConvertPackRow;
+
+    /// Pack xrgb row function, selected by image format, NULL = 32bit lsb.
+static VideoPackRowFunc *VideoPackRow;
+
+///
+///	Select the pixel pack functions for the osd image format.
+///
+static void VideoPackInit(void)
+{
+    int rgb888;
+    int lsb;
+
+    rgb888 = VideoArgb || (VideoRedMask == 0xFF0000
+	&& VideoGreenMask == 0x00FF00 && VideoBlueMask == 0x0000FF);
+    lsb = VideoByteOrder == XCB_IMAGE_ORDER_LSB_FIRST;
+
+    // generic: shifts and byte order are fixed here, not per pixel
+    VideoGenericComponentInit(&VideoGenericShift[0], 16, VideoRedMask);
+    VideoGenericComponentInit(&VideoGenericShift[1], 8, VideoGreenMask);
+    VideoGenericComponentInit(&VideoGenericShift[2], 0, VideoBlueMask);
+    VideoGenericBytes = VideoBitsPerPixel / 8;
+    VideoPackRow = lsb ? VideoPackRowGenericLSB : VideoPackRowGenericMSB;
+    VideoConvertPackRow =
+	lsb ? VideoConvertPackRowKeyGenericLSB :
+	VideoConvertPackRowKeyGenericMSB;
+    if (VideoArgb) {			// a8r8g8b8 only
+	VideoPackRow = lsb ? NULL : VideoPackRow32MSB;
+	VideoConvertPackRow =
+	    lsb ? VideoConvertPackRowPremultiply32LSB :
+	    VideoConvertPackRowPremultiply32MSB;
+    } else if (VideoBitsPerPixel == 32 && rgb888) {
+	// fastest: converted directly into the surface
+	VideoPackRow = lsb ? NULL : VideoPackRow32MSB;
+	VideoConvertPackRow =
+	    lsb ? VideoConvertPackRowKey32LSB : VideoConvertPackRowKey32MSB;
+    } else if (VideoBitsPerPixel == 24 && rgb888) {
+	VideoPackRow = lsb ? VideoPackRow24LSB : VideoPackRow24MSB;
+	VideoConvertPackRow =
+	    lsb ? VideoConvertPackRowKey24LSB : VideoConvertPackRowKey24MSB;
+    } else if (VideoBitsPerPixel == 16 && VideoRedMask == 0xF800
+	&& VideoGreenMask == 0x07E0 && VideoBlueMask == 0x001F) {
+	VideoPackRow = lsb ? VideoPackRow565LSB : VideoPackRow565MSB;
+	VideoConvertPackRow =
+	    lsb ? VideoConvertPackRowKey565LSB : VideoConvertPackRowKey565MSB;
+    }
+    Debug(3, "video: %s pixel pack for %d bpp %06x/%06x/%06x\n",
+	VideoPackRow == VideoPackRowGenericLSB
+	|| VideoPackRow == VideoPackRowGenericMSB ? "generic" : "fast",
+	VideoBitsPerPixel, VideoRedMask, VideoGreenMask, VideoBlueMask);
+}
+
+///
+///	Select the fastest pixel conversion functions for this cpu.
+///
+static void VideoConvertInit(void)
+{
+    VideoPackInit();
+
+    if (VideoArgb) {
+	Debug(3, "video: using premultiplied argb pixel conversion\n");
+	VideoConvertRow = VideoConvertRowPremultiply;
+	return;
+    }
+    VideoConvertRow = VideoConvertRowC;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+	Debug(3, "video: using avx2 pixel conversion\n");
+	VideoConvertRow = VideoConvertRowAVX2;
+	return;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+	Debug(3, "video: using sse2 pixel conversion\n");
+	VideoConvertRow = VideoConvertRowSSE2;
 	return;
     }
-    xcb_unmap_window(Connection, VideoOsdWindow);
+#endif
+    Debug(3, "video: using C pixel conversion\n");
 }
 
 ///
-///	Clear window.
+///	Get the reusable image buffer.
 ///
-void VideoWindowClear(void)
+///	The buffer only grows, it is kept until VideoExit().
+///
+///	@param size	needed size in bytes
+///
+///	@returns image buffer of at least @p size bytes.
+///
+static uint8_t *VideoImageAlloc(size_t size)
 {
-    if (!Connection) {
-	Debug(3, "play: FIXME: must restore osd provider\n");
+    if (size > VideoImageSize) {
+	free(VideoImageData);
+	if (!(VideoImageData = malloc(size))) {
+	    Fatal(_("video: out of memory\n"));
+	}
+	VideoImageSize = size;
+    }
+    return VideoImageData;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//	MIT-SHM
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	Check if the display is on the local machine.
+///
+///	@param display_name	x11 display name (host:display.screen)
+///
+///	@returns true if the display is reached through a local socket.
+///
+static int VideoIsLocalDisplay(const char *display_name)
+{
+    const char *colon;
+
+    if (!display_name || !(colon = strrchr(display_name, ':'))) {
+	return 0;
+    }
+    if (colon == display_name) {	// ":0.0"
+	return 1;
+    }
+    return colon - display_name == 4 && !strncmp(display_name, "unix", 4);
+}
+
+///
+///	Setup shared memory segment for the osd surface.
+///
+///	Any failure keeps the xcb_put_image() socket path.
+///
+///	@param size	size of osd surface in bytes
+///
+static void VideoShmInit(size_t size)
+{
+    const xcb_query_extension_reply_t *extension;
+    xcb_shm_query_version_reply_t *reply;
+    xcb_generic_error_t *error;
+    xcb_shm_seg_t seg;
+    void *data;
+    int id;
+
+    extension = xcb_get_extension_data(Connection, &xcb_shm_id);
+    if (!extension || !extension->present) {
+	Info(_("video: no MIT-SHM extension\n"));
+	return;
+    }
+    reply =
+	xcb_shm_query_version_reply(Connection,
+	xcb_shm_query_version(Connection), NULL);
+    if (!reply) {
 	return;
     }
-    xcb_clear_area(Connection, 0, VideoOsdWindow, 0, 0, VideoWindowWidth,
-	VideoWindowHeight);
-    xcb_flush(Connection);
+    free(reply);
+
+    id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (id == -1) {
+	Error(_("video: shmget failed: %s\n"), strerror(errno));
+	return;
+    }
+    data = shmat(id, NULL, 0);
+    if (data == (void *)-1) {
+	Error(_("video: shmat failed: %s\n"), strerror(errno));
+	shmctl(id, IPC_RMID, NULL);
+	return;
+    }
+
+    seg = xcb_generate_id(Connection);
+    error = xcb_request_check(Connection,
+	xcb_shm_attach_checked(Connection, seg, id, 0));
+    // server has attached, segment is freed after last detach
+    shmctl(id, IPC_RMID, NULL);
+    if (error) {
+	Warning(_("video: can't attach MIT-SHM segment\n"));
+	free(error);
+	shmdt(data);
+	return;
+    }
+
+    Debug(3, "video: using MIT-SHM %dx%d\n", VideoOsdWidth,
+	VideoOsdHeight);
+    VideoShmSeg = seg;
+    VideoShmData = data;
+    VideoShmPending = 0;
+}
+
+///
+///	Cleanup shared memory segment.
+///
+static void VideoShmExit(void)
+{
+    if (VideoShmSeg != XCB_NONE) {
+	xcb_shm_detach(Connection, VideoShmSeg);
+	VideoShmSeg = XCB_NONE;
+    }
+    if (VideoShmData) {
+	shmdt(VideoShmData);
+	VideoShmData = NULL;
+    }
+}
+
+///
+///	Wait until the server has finished reading the shared memory.
+///
+static void VideoShmSync(void)
+{
+    if (VideoShmPending) {
+	// round trip, all previous requests are processed after it
+	free(xcb_get_input_focus_reply(Connection,
+		xcb_get_input_focus(Connection), NULL));
+	VideoShmPending = 0;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//	OSD surface
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	Fill osd surface with the transparent pixel.
+///
+static void VideoOsdSurfaceFill(void)
+{
+    uint32_t *row;
+    unsigned x;
+    unsigned y;
+
+    // first row pixel by pixel, others are copies
+    row = VideoPackRow ? (uint32_t *) VideoImageAlloc(VideoOsdWidth *
+	sizeof(*row)) : (uint32_t *) VideoOsdSurface;
+    for (x = 0; x < VideoOsdWidth; ++x) {
+	row[x] = VideoOsdKey;
+    }
+    if (VideoPackRow) {
+	VideoPackRow(VideoOsdSurface, row, VideoOsdWidth);
+    }
+    for (y = 1; y < VideoOsdHeight; ++y) {
+	memcpy(VideoOsdSurface + y * VideoOsdStride, VideoOsdSurface,
+	    VideoOsdStride);
+    }
+}
+
+///
+///	Hash bytes of a surface row.
+///
+///	@param hash	hash of previous data
+///	@param data	bytes to hash
+///	@param bytes	number of bytes
+///
+static uint64_t VideoHashBytes(uint64_t hash, const uint8_t * data,
+    unsigned bytes)
+{
+    unsigned j;
+
+    for (j = 0; j + 8 <= bytes; j += 8) {
+	uint64_t v;
+
+	memcpy(&v, data + j, sizeof(v));
+	hash ^= v * 0x87C37B91114253D5ULL;
+	hash = ((hash << 27) | (hash >> 37)) * 0x4CF5AD432745937FULL;
+    }
+    for (; j < bytes; ++j) {
+	hash = (hash ^ data[j]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+///
+///	Calculate hash of a tile of the osd surface.
+///
+///	@param tx	tile column
+///	@param ty	tile row
+///
+static uint64_t VideoTileHashCalc(unsigned tx, unsigned ty)
+{
+    const uint8_t *row;
+    uint64_t hash;
+    unsigned bytes;
+    unsigned h;
+    unsigned i;
+
+    bytes = VideoOsdWidth - tx * VIDEO_TILE_SIZE;
+    if (bytes > VIDEO_TILE_SIZE) {
+	bytes = VIDEO_TILE_SIZE;
+    }
+    bytes *= VideoBitsPerPixel / 8;
+    h = VideoOsdHeight - ty * VIDEO_TILE_SIZE;
+    if (h > VIDEO_TILE_SIZE) {
+	h = VIDEO_TILE_SIZE;
+    }
+
+    row =
+	VideoOsdSurface + ty * VIDEO_TILE_SIZE * VideoOsdStride +
+	tx * VIDEO_TILE_SIZE * VideoBitsPerPixel / 8;
+    hash = 0x9E3779B97F4A7C15ULL;
+    for (i = 0; i < h; ++i) {
+	hash = VideoHashBytes(hash, row, bytes);
+	row += VideoOsdStride;
+    }
+    return hash;
+}
+
+///
+///	Setup osd surface.
+///
+///	The surface is a copy of the osd window in the native image format
+///	of the server.  Draws are converted into it, flushes upload the
+///	damaged parts.  With MIT-SHM the surface is the shared segment.
+///
+///	@param shm	flag try to use shared memory
+///
+static void VideoOsdSurfaceInit(int shm)
+{
+    size_t size;
+    unsigned tx;
+    unsigned ty;
+
+    VideoOsdStride =
+	((VideoOsdWidth * VideoBitsPerPixel + VideoScanlinePad -
+	    1) / VideoScanlinePad) * VideoScanlinePad / 8;
+    size = VideoOsdStride * VideoOsdHeight;
+
+    if (shm) {
+	VideoShmInit(size);
+    }
+    if (VideoShmSeg != XCB_NONE) {
+	VideoOsdSurface = VideoShmData;
+    } else if (!(VideoOsdSurface = malloc(size))) {
+	Fatal(_("video: out of memory\n"));
+    }
+    VideoOsdSurfaceFill();
+    VideoDamageN = 0;
+
+    // pixmap starts with the same transparent content
+    VideoTilesX = (VideoOsdWidth + VIDEO_TILE_SIZE - 1) / VIDEO_TILE_SIZE;
+    VideoTilesY = (VideoOsdHeight + VIDEO_TILE_SIZE - 1) / VIDEO_TILE_SIZE;
+    if (!(VideoTileHash =
+	    malloc(VideoTilesX * VideoTilesY * sizeof(*VideoTileHash)))
+	|| !(VideoFills =
+	    malloc(VideoTilesX * VideoTilesY * sizeof(*VideoFills)))) {
+	Fatal(_("video: out of memory\n"));
+    }
+    for (ty = 0; ty < VideoTilesY; ++ty) {
+	for (tx = 0; tx < VideoTilesX; ++tx) {
+	    VideoTileHash[ty * VideoTilesX + tx] = VideoTileHashCalc(tx, ty);
+	}
+    }
+}
+
+///
+///	Cleanup osd surface.
+///
+static void VideoOsdSurfaceExit(void)
+{
+    if (VideoOsdSurface && VideoOsdSurface != VideoShmData) {
+	free(VideoOsdSurface);
+    }
+    VideoOsdSurface = NULL;
+    free(VideoTileHash);
+    VideoTileHash = NULL;
+    free(VideoFills);
+    VideoFills = NULL;
+    VideoFillN = 0;
+    VideoShmExit();
+    VideoDamageN = 0;
+}
+
+///
+///	Add damaged rectangle of osd surface.
+///
+///	Overlapping or adjacent rectangles are merged, when the merged
+///	rectangle isn't bigger than both rectangles together.
+///
+///	@param x	x position of damaged area
+///	@param y	y position of damaged area
+///	@param width	width of damaged area
+///	@param height	height of damaged area
+///
+static void VideoDamageAdd(int x, int y, int width, int height)
+{
+    int x2;
+    int y2;
+    int i;
+
+    x2 = x + width;
+    y2 = y + height;
+
+  again:
+    for (i = 0; i < VideoDamageN; ++i) {
+	const xcb_rectangle_t *rect;
+	int ux1;
+	int uy1;
+	int ux2;
+	int uy2;
+
+	rect = VideoDamage + i;
+	// neither overlapping nor adjacent
+	if (x > rect->x + rect->width || rect->x > x2
+	    || y > rect->y + rect->height || rect->y > y2) {
+	    continue;
+	}
+	ux1 = x < rect->x ? x : rect->x;
+	uy1 = y < rect->y ? y : rect->y;
+	ux2 = x2 > rect->x + rect->width ? x2 : rect->x + rect->width;
+	uy2 = y2 > rect->y + rect->height ? y2 : rect->y + rect->height;
+	if ((ux2 - ux1) * (uy2 - uy1) >
+	    (x2 - x) * (y2 - y) + rect->width * rect->height) {
+	    continue;			// union would upload more
+	}
+	// remove merged rectangle and retry with the union
+	VideoDamage[i] = VideoDamage[--VideoDamageN];
+	x = ux1;
+	y = uy1;
+	x2 = ux2;
+	y2 = uy2;
+	goto again;
+    }
+
+    if (VideoDamageN == VIDEO_DAMAGE_MAX) {
+	// too many rectangles, use the bounding box of all
+	for (i = 0; i < VideoDamageN; ++i) {
+	    const xcb_rectangle_t *rect;
+
+	    rect = VideoDamage + i;
+	    if (rect->x < x) {
+		x = rect->x;
+	    }
+	    if (rect->y < y) {
+		y = rect->y;
+	    }
+	    if (rect->x + rect->width > x2) {
+		x2 = rect->x + rect->width;
+	    }
+	    if (rect->y + rect->height > y2) {
+		y2 = rect->y + rect->height;
+	    }
+	}
+	VideoDamageN = 0;
+    }
+
+    VideoDamage[VideoDamageN].x = x;
+    VideoDamage[VideoDamageN].y = y;
+    VideoDamage[VideoDamageN].width = x2 - x;
+    VideoDamage[VideoDamageN].height = y2 - y;
+    ++VideoDamageN;
+}
+
+///
+///	Check if an area of the osd surface has only one color.
+///
+///	@param x	x position of area
+///	@param y	y position of area
+///	@param width	width of area
+///	@param height	height of area
+///	@param[out] pixel	native pixel value of the solid area
+///
+///	@returns true if all pixels of the area are equal.
+///
+static int VideoOsdIsSolid(int x, int y, int width, int height,
+    uint32_t * pixel)
+{
+    const uint8_t *row;
+    unsigned bytes;
+    int i;
+
+    bytes = VideoBitsPerPixel / 8;
+    row = VideoOsdSurface + y * VideoOsdStride + x * bytes;
+
+    // first row pixel by pixel, other rows against the first
+    for (i = 1; i < width; ++i) {
+	if (memcmp(row, row + i * bytes, bytes)) {
+	    return 0;
+	}
+    }
+    for (i = 1; i < height; ++i) {
+	if (memcmp(row, row + i * VideoOsdStride, width * bytes)) {
+	    return 0;
+	}
+    }
+
+    *pixel = 0;
+    for (i = 0; i < (int)bytes; ++i) {
+	if (VideoByteOrder == XCB_IMAGE_ORDER_LSB_FIRST) {
+	    *pixel |= row[i] << (i * 8);
+	} else {
+	    *pixel = (*pixel << 8) | row[i];
+	}
+    }
+    return 1;
+}
+
+///
+///	Compare solid areas by pixel value.
+///
+static int VideoFillCmp(const void *a, const void *b)
+{
+    uint32_t pa;
+    uint32_t pb;
+
+    pa = ((const VideoOsdFill *)a)->Pixel;
+    pb = ((const VideoOsdFill *)b)->Pixel;
+    return pa < pb ? -1 : pa > pb;
+}
+
+///
+///	Fill the solid areas into the backing pixmap.
+///
+///	Areas with the same color are filled with one request.  The filled
+///	areas are added to the damage for presenting.
+///
+static void VideoFillRects(void)
+{
+    xcb_rectangle_t rects[64];
+    int n;
+    int i;
+
+    qsort(VideoFills, VideoFillN, sizeof(*VideoFills), VideoFillCmp);
+    for (i = 0; i < VideoFillN;) {
+	uint32_t pixel;
+
+	pixel = VideoFills[i].Pixel;
+	if (VideoShape && pixel == VideoOsdKeyPixel) {
+	    ++i;			// shaped away, content doesn't matter
+	    continue;
+	}
+	if (pixel != VideoOsdForeground) {
+	    xcb_change_gc(Connection, VideoOsdGC, XCB_GC_FOREGROUND, &pixel);
+	    VideoOsdForeground = pixel;
+	}
+	for (n = 0; i < VideoFillN && VideoFills[i].Pixel == pixel
+	    && n < (int)(sizeof(rects) / sizeof(*rects)); ++i) {
+	    rects[n++] = VideoFills[i].Rect;
+	    VideoDamageAdd(VideoFills[i].Rect.x, VideoFills[i].Rect.y,
+		VideoFills[i].Rect.width, VideoFills[i].Rect.height);
+	}
+	xcb_poly_fill_rectangle(Connection, VideoOsdPixmap, VideoOsdGC, n,
+	    rects);
+    }
+    Debug(4, "video: %d solid areas\n", VideoFillN);
+    VideoFillN = 0;
+}
+
+///
+///	Damage the tiles of an area, which differ from the backing pixmap.
+///
+///	The whole changed tile is damaged, not only its part inside @p
+///	rect: the tile hash covers the whole tile, another damaged area
+///	touching the same tile would see a matching hash and skip its part.
+///	Each tile is damaged at most once per upload, VideoFills has one
+///	entry per tile.  Changed tiles with only one color are collected
+///	as solid areas, they are filled by the server instead of uploaded.
+///
+///	@param rect	damaged area of osd surface
+///
+static void VideoTileDamage(const xcb_rectangle_t * rect)
+{
+    unsigned tx;
+    unsigned ty;
+
+    for (ty = rect->y / VIDEO_TILE_SIZE;
+	ty * VIDEO_TILE_SIZE < (unsigned)rect->y + rect->height; ++ty) {
+	for (tx = rect->x / VIDEO_TILE_SIZE;
+	    tx * VIDEO_TILE_SIZE < (unsigned)rect->x + rect->width; ++tx) {
+	    uint64_t hash;
+	    int x1;
+	    int y1;
+	    int x2;
+	    int y2;
+
+	    hash = VideoTileHashCalc(tx, ty);
+	    if (hash == VideoTileHash[ty * VideoTilesX + tx]) {
+		continue;
+	    }
+	    VideoTileHash[ty * VideoTilesX + tx] = hash;
+
+	    // whole tile, last row and column are clipped by the surface
+	    x1 = tx * VIDEO_TILE_SIZE;
+	    y1 = ty * VIDEO_TILE_SIZE;
+	    x2 = x1 + VIDEO_TILE_SIZE;
+	    y2 = y1 + VIDEO_TILE_SIZE;
+	    if (x2 > (int)VideoOsdWidth) {
+		x2 = VideoOsdWidth;
+	    }
+	    if (y2 > (int)VideoOsdHeight) {
+		y2 = VideoOsdHeight;
+	    }
+	    if (VideoOsdIsSolid(x1, y1, x2 - x1, y2 - y1,
+		    &VideoFills[VideoFillN].Pixel)) {
+		VideoFills[VideoFillN].Rect.x = x1;
+		VideoFills[VideoFillN].Rect.y = y1;
+		VideoFills[VideoFillN].Rect.width = x2 - x1;
+		VideoFills[VideoFillN].Rect.height = y2 - y1;
+		++VideoFillN;
+		continue;
+	    }
+	    VideoDamageAdd(x1, y1, x2 - x1, y2 - y1);
+	}
+    }
+}
+
+    /// Maximal rows per put image request, limits the i/o vector count.
+#define VIDEO_PUT_ROWS_MAX 256
+
+///
+///	Send put image request with the rows taken from the osd surface.
+///
+///	Each row is its own i/o vector, the rows are written by xcb
+///	directly from the surface without packing them into a buffer.
+///
+///	@param x	x position of rows in osd window
+///	@param y	y position of rows in osd window
+///	@param width	width of rows
+///	@param height	number of rows, at most #VIDEO_PUT_ROWS_MAX
+///
+static void VideoPutImageRows(int x, int y, int width, int height)
+{
+    static const uint8_t pad[4];
+    // two vectors before the request are reserved for xcb
+    struct iovec parts[2 + 1 + 2 * VIDEO_PUT_ROWS_MAX];
+    xcb_protocol_request_t request;
+    xcb_put_image_request_t out;
+    unsigned bytes;
+    unsigned stride;
+    int n;
+    int i;
+
+    bytes = width * VideoBitsPerPixel / 8;
+    stride =
+	((width * VideoBitsPerPixel + VideoScanlinePad -
+	    1) / VideoScanlinePad) * VideoScanlinePad / 8;
+
+    memset(&out, 0, sizeof(out));
+    out.format = XCB_IMAGE_FORMAT_Z_PIXMAP;
+    out.drawable = VideoOsdPixmap;
+    out.gc = VideoOsdGC;
+    out.width = width;
+    out.height = height;
+    out.dst_x = x;
+    out.dst_y = y;
+    out.left_pad = 0;
+    out.depth = VideoOsdDepth;
+
+    n = 2;
+    parts[n].iov_base = &out;
+    parts[n++].iov_len = sizeof(out);
+    for (i = 0; i < height; ++i) {
+	parts[n].iov_base =
+	    VideoOsdSurface + (y + i) * VideoOsdStride +
+	    x * VideoBitsPerPixel / 8;
+	parts[n++].iov_len = bytes;
+	if (stride != bytes) {		// scanline padding
+	    parts[n].iov_base = (void *)pad;
+	    parts[n++].iov_len = stride - bytes;
+	}
+    }
+
+    request.count = n - 2;
+    request.ext = NULL;
+    request.opcode = XCB_PUT_IMAGE;
+    request.isvoid = 1;
+    xcb_send_request(Connection, 0, parts + 2, &request);
+}
+
+///
+///	Scale an osd coordinate into a window coordinate.
+///
+///	Returns the first window pixel whose center maps to or after osd
+///	coordinate @p x, exact for nearest filtering.
+///
+///	@param x	osd coordinate
+///	@param osd	osd size
+///	@param window	window size
+///
+static int VideoScaleCoord(int x, unsigned osd, unsigned window)
+{
+    // ceil(x * window / osd - 1/2)
+    return (2 * (int64_t) x * window + osd - 1) / (2 * osd);
+}
+
+///
+///	Scale an osd rectangle into window coordinates.
+///
+///	@param rect	rectangle, osd coordinates in, window coordinates out
+///
+static void VideoScaleRect(xcb_rectangle_t * rect)
+{
+    int x2;
+    int y2;
+
+    x2 = VideoScaleCoord(rect->x + rect->width, VideoOsdWidth,
+	VideoWindowWidth);
+    y2 = VideoScaleCoord(rect->y + rect->height, VideoOsdHeight,
+	VideoWindowHeight);
+    rect->x = VideoScaleCoord(rect->x, VideoOsdWidth, VideoWindowWidth);
+    rect->y = VideoScaleCoord(rect->y, VideoOsdHeight, VideoWindowHeight);
+    rect->width = x2 - rect->x;
+    rect->height = y2 - rect->y;
+}
+
+///
+///	Present a part of the backing pixmap in the osd window.
+///
+///	With the argb visual or a scaled osd, the pixmap is composited with
+///	XRender.  The scale transform of the pixmap picture maps window
+///	coordinates to osd coordinates.  The argb osd window is a top-level
+///	window, the compositing manager blends it over the video.
+///
+///	@param x	x position of area in window
+///	@param y	y position of area in window
+///	@param width	width of area
+///	@param height	height of area
+///
+static void VideoOsdPresentWindow(int x, int y, int width, int height)
+{
+    if (VideoPixmapPicture != XCB_NONE) {
+	// source replaces the window contents, alpha is kept
+	xcb_render_composite(Connection, XCB_RENDER_PICT_OP_SRC,
+	    VideoPixmapPicture, XCB_NONE, VideoOsdPicture, x, y, 0, 0, x, y,
+	    width, height);
+	return;
+    }
+    xcb_copy_area(Connection, VideoOsdPixmap, VideoOsdWindow, VideoOsdGC, x,
+	y, x, y, width, height);
+}
+
+///
+///	Present a part of the osd in the osd window.
+///
+///	A scaled area grows by a window pixel on each side, bilinear
+///	filtering blends the neighbour pixels of the osd.
+///
+///	@param x	x position of area in osd
+///	@param y	y position of area in osd
+///	@param width	width of area
+///	@param height	height of area
+///
+static void VideoOsdPresent(int x, int y, int width, int height)
+{
+    xcb_rectangle_t rect;
+
+    if (!VideoOsdScaled) {
+	VideoOsdPresentWindow(x, y, width, height);
+	return;
+    }
+    rect.x = x;
+    rect.y = y;
+    rect.width = width;
+    rect.height = height;
+    VideoScaleRect(&rect);
+    x = rect.x > 0 ? rect.x - 1 : 0;
+    y = rect.y > 0 ? rect.y - 1 : 0;
+    width = rect.x + rect.width + 1 - x;
+    height = rect.y + rect.height + 1 - y;
+    if (x + width > (int)VideoWindowWidth) {
+	width = VideoWindowWidth - x;
+    }
+    if (y + height > (int)VideoWindowHeight) {
+	height = VideoWindowHeight - y;
+    }
+    if (width > 0 && height > 0) {
+	VideoOsdPresentWindow(x, y, width, height);
+    }
+}
+
+///
+///	Upload a rectangle of the osd surface to the osd window.
+///
+///	The rectangle is uploaded into the backing pixmap.  Without shared
+///	memory it is a stripe of VideoStripeRows() rows.
+///
+///	@param rect	rectangle in osd coordinates
+///
+static void VideoUploadRect(const xcb_rectangle_t * rect)
+{
+    if (VideoShmSeg != XCB_NONE) {
+	xcb_shm_put_image(Connection, VideoOsdPixmap, VideoOsdGC,
+	    VideoOsdWidth, VideoOsdHeight, rect->x, rect->y,
+	    rect->width, rect->height, rect->x, rect->y, VideoOsdDepth,
+	    XCB_IMAGE_FORMAT_Z_PIXMAP, 0, VideoShmSeg, 0);
+	VideoShmPending = 1;
+    } else {
+	VideoPutImageRows(rect->x, rect->y, rect->width, rect->height);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//	Shape
+//////////////////////////////////////////////////////////////////////////////
+
+    /// Maximal rectangles per shape request.
+#define VIDEO_SHAPE_RECTS_MAX 4096
+
+///
+///	Send shape rectangles of osd window.
+///
+///	@param op	shape operation
+///	@param rects	rectangles in osd coordinates, scaled in place
+///	@param n	number of rectangles
+///
+static void VideoShapeSend(xcb_shape_op_t op, xcb_rectangle_t * rects, int n)
+{
+    int i;
+
+    if (VideoOsdScaled) {
+	for (i = 0; i < n; ++i) {
+	    VideoScaleRect(rects + i);
+	}
+    }
+    for (i = 0; i < n; i += VIDEO_SHAPE_RECTS_MAX) {
+	xcb_shape_rectangles(Connection, op, XCB_SHAPE_SK_BOUNDING,
+	    XCB_CLIP_ORDERING_UNSORTED, VideoOsdWindow, 0, 0,
+	    n - i > VIDEO_SHAPE_RECTS_MAX ? VIDEO_SHAPE_RECTS_MAX : n - i,
+	    rects + i);
+    }
+}
+
+///
+///	Add rectangle to the shape rectangles.
+///
+///	@param n	number of rectangles already used
+///
+///	@returns the new rectangle.
+///
+static xcb_rectangle_t *VideoShapeRectAdd(int n)
+{
+    if (n == VideoShapeSize) {
+	VideoShapeSize = VideoShapeSize ? VideoShapeSize * 2 : 256;
+	if (!(VideoShapeRects =
+		realloc(VideoShapeRects,
+		    VideoShapeSize * sizeof(*VideoShapeRects)))) {
+	    Fatal(_("video: out of memory\n"));
+	}
+    }
+    return VideoShapeRects + n;
+}
+
+///
+///	Collect the opaque parts of an area of the osd surface.
+///
+///	Each row is split into runs of non transparent pixels.  Runs with
+///	the same columns as a run of the row above extend its rectangle.
+///
+///	@param rect	area of osd surface
+///	@param n	number of shape rectangles already used
+///
+///	@returns number of shape rectangles used.
+///
+static int VideoShapeScan(const xcb_rectangle_t * rect, int n)
+{
+    uint8_t key[4];
+    int bytes;
+    int above;				// first rectangle of row above
+    int row_start;
+    int y;
+    int i;
+
+    bytes = VideoBitsPerPixel / 8;
+    for (i = 0; i < bytes; ++i) {
+	key[i] =
+	    VideoOsdKeyPixel >> (VideoByteOrder ==
+	    XCB_IMAGE_ORDER_LSB_FIRST ? i * 8 : (bytes - 1 - i) * 8);
+    }
+
+    above = n;
+    row_start = n;
+    for (y = rect->y; y < rect->y + rect->height; ++y) {
+	const uint8_t *row;
+	int x;
+
+	row = VideoOsdSurface + y * VideoOsdStride;
+	x = rect->x;
+	while (x < rect->x + rect->width) {
+	    int x1;
+
+	    while (x < rect->x + rect->width
+		&& !memcmp(row + x * bytes, key, bytes)) {
+		++x;
+	    }
+	    if (x == rect->x + rect->width) {
+		break;
+	    }
+	    x1 = x;
+	    while (x < rect->x + rect->width
+		&& memcmp(row + x * bytes, key, bytes)) {
+		++x;
+	    }
+	    // rectangles of row above are sorted by x
+	    while (above < row_start && VideoShapeRects[above].x < x1) {
+		++above;
+	    }
+	    if (above < row_start && VideoShapeRects[above].x == x1
+		&& VideoShapeRects[above].width == x - x1) {
+		VideoShapeRects[above].height++;
+		// keep it as rectangle of this row
+		VideoShapeRectAdd(n);
+		VideoShapeRects[n] = VideoShapeRects[above];
+		VideoShapeRects[above].width = 0;
+		++n;
+		++above;
+		continue;
+	    }
+	    VideoShapeRectAdd(n);
+	    VideoShapeRects[n].x = x1;
+	    VideoShapeRects[n].y = y;
+	    VideoShapeRects[n].width = x - x1;
+	    VideoShapeRects[n].height = 1;
+	    ++n;
+	}
+	above = row_start;
+	row_start = n;
+    }
+    return n;
+}
+
+///
+///	Update the bounding shape of the osd window from the changed areas.
+///
+///	Changed areas are removed from the shape and their opaque parts
+///	are added again.  Transparent pixels are outside of the shape,
+///	their content is never shown.
+///
+static void VideoShapeUpdate(void)
+{
+    int n;
+    int i;
+    int j;
+
+    // remove all changed areas
+    n = 0;
+    for (i = 0; i < VideoDamageN; ++i) {
+	*VideoShapeRectAdd(n++) = VideoDamage[i];
+    }
+    for (i = 0; i < VideoFillN; ++i) {
+	*VideoShapeRectAdd(n++) = VideoFills[i].Rect;
+    }
+    VideoShapeSend(XCB_SHAPE_SO_SUBTRACT, VideoShapeRects, n);
+
+    // add the opaque parts
+    n = 0;
+    for (i = 0; i < VideoFillN; ++i) {
+	if (VideoFills[i].Pixel != VideoOsdKeyPixel) {
+	    *VideoShapeRectAdd(n++) = VideoFills[i].Rect;
+	}
+    }
+    for (i = 0; i < VideoDamageN; ++i) {
+	n = VideoShapeScan(VideoDamage + i, n);
+    }
+    // remove rectangles merged into the next row
+    for (i = j = 0; i < n; ++i) {
+	if (VideoShapeRects[i].width) {
+	    VideoShapeRects[j++] = VideoShapeRects[i];
+	}
+    }
+    VideoShapeSend(XCB_SHAPE_SO_UNION, VideoShapeRects, j);
+}
+
+///
+///	Update the bounding shape of one osd area.
+///
+///	@param rect	area of osd surface
+///
+static void VideoShapeArea(const xcb_rectangle_t * rect)
+{
+    xcb_rectangle_t area;
+    int n;
+    int i;
+    int j;
+
+    area = *rect;
+    VideoShapeSend(XCB_SHAPE_SO_SUBTRACT, &area, 1);
+    n = VideoShapeScan(rect, 0);
+    for (i = j = 0; i < n; ++i) {
+	if (VideoShapeRects[i].width) {
+	    VideoShapeRects[j++] = VideoShapeRects[i];
+	}
+    }
+    VideoShapeSend(XCB_SHAPE_SO_UNION, VideoShapeRects, j);
+}
+
+///
+///	Setup osd transparency by shape.
+///
+///	@returns true if the shape extension is available.
+///
+static int VideoShapeInit(void)
+{
+    const xcb_query_extension_reply_t *extension;
+    xcb_shape_query_version_reply_t *reply;
+
+    extension = xcb_get_extension_data(Connection, &xcb_shape_id);
+    if (!extension || !extension->present) {
+	Warning(_("video: no X shape extension\n"));
+	return 0;
+    }
+    reply =
+	xcb_shape_query_version_reply(Connection,
+	xcb_shape_query_version(Connection), NULL);
+    if (!reply) {
+	return 0;
+    }
+    Debug(3, "video: X shape %d.%d\n", reply->major_version,
+	reply->minor_version);
+    free(reply);
+
+    // surface starts transparent: empty shape
+    xcb_shape_rectangles(Connection, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_BOUNDING,
+	XCB_CLIP_ORDERING_UNSORTED, VideoOsdWindow, 0, 0, 0, NULL);
+    return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	Clip an image to the osd window.
+///
+///	@param[in,out] x	x position of image in osd
+///	@param[in,out] y	y position of image in osd
+///	@param[in,out] width	width of visible image part
+///	@param[in,out] height	height of visible image part
+///	@param[out] sx	x offset of visible part in image
+///	@param[out] sy	y offset of visible part in image
+///
+///	@returns false if nothing of the image is visible.
+///
+static int VideoClip(int *x, int *y, int *width, int *height, int *sx,
+    int *sy)
+{
+    *sx = 0;
+    *sy = 0;
+    if (*x < 0) {
+	*sx = -*x;
+	*width += *x;
+	*x = 0;
+    }
+    if (*y < 0) {
+	*sy = -*y;
+	*height += *y;
+	*y = 0;
+    }
+    if (*x + *width > (int)VideoOsdWidth) {
+	*width = VideoOsdWidth - *x;
+    }
+    if (*y + *height > (int)VideoOsdHeight) {
+	*height = VideoOsdHeight - *y;
+    }
+    return *width > 0 && *height > 0;
+}
+
+///
+///	Convert ARGB image into the native image format.
+///
+///	@param dst	output image
+///	@param stride	bytes per row of @p dst
+///	@param src	input argb image, rows are @p w pixels
+///	@param w	width of image
+///	@param h	height of image
+///
+static void VideoConvertRect(uint8_t * dst, unsigned stride,
+    const uint32_t * src, int w, int h)
+{
+    int i;
+
+    for (i = 0; i < h; ++i) {
+	VideoConvertPackRow(dst + i * stride, src + i * w, w, VideoOsdKey);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//	Workers
+//////////////////////////////////////////////////////////////////////////////
+
+    /// Minimal pixels of a conversion to use the worker threads.
+#define VIDEO_WORKER_PIXELS (128 * 1024)
+
+    /// Maximal number of conversion worker threads.
+#define VIDEO_WORKER_MAX 7
+
+///
+///	Conversion split into row bands.
+///
+typedef struct _video_convert_job_
+{
+    uint8_t *Dst;			///< output image
+    unsigned Stride;			///< bytes per row of output image
+    const uint32_t *Src;		///< input argb image
+    int Width;				///< width of image
+    int Height;				///< height of image
+    int BandRows;			///< rows per band
+    int Bands;				///< number of bands
+    int NextBand;			///< next band to convert
+    int DoneBands;			///< number of converted bands
+} VideoConvertJob;
+
+static pthread_t VideoWorker[VIDEO_WORKER_MAX];	///< worker threads
+static int VideoWorkerN;		///< number of worker threads
+static pthread_mutex_t VideoWorkerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t VideoWorkerCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t VideoWorkerDoneCond = PTHREAD_COND_INITIALIZER;
+static VideoConvertJob *VideoWorkerJob;	///< current job of workers
+static unsigned VideoWorkerGeneration;	///< job counter, wakes workers
+static int VideoWorkerBusy;		///< workers using current job
+static char VideoWorkerStop;		///< request workers stop
+
+///
+///	Convert bands of a job until all bands are taken.
+///
+///	@param job	conversion job
+///
+static void VideoConvertBands(VideoConvertJob * job)
+{
+    int band;
+
+    while ((band =
+	    __atomic_fetch_add(&job->NextBand, 1,
+		__ATOMIC_RELAXED)) < job->Bands) {
+	int y;
+	int h;
+
+	y = band * job->BandRows;
+	h = job->Height - y < job->BandRows ? job->Height - y : job->BandRows;
+	VideoConvertRect(job->Dst + y * job->Stride, job->Stride,
+	    job->Src + y * job->Width, job->Width, h);
+	if (__atomic_add_fetch(&job->DoneBands, 1,
+		__ATOMIC_ACQ_REL) == job->Bands) {
+	    pthread_mutex_lock(&VideoWorkerMutex);
+	    pthread_cond_signal(&VideoWorkerDoneCond);
+	    pthread_mutex_unlock(&VideoWorkerMutex);
+	}
+    }
+}
+
+///
+///	Conversion worker thread.
+///
+static void *VideoWorkerHandler( __attribute__ ((unused))
+    void *dummy)
+{
+    unsigned generation;
+
+    pthread_mutex_lock(&VideoWorkerMutex);
+    generation = VideoWorkerGeneration;
+    for (;;) {
+	VideoConvertJob *job;
+
+	while (!VideoWorkerStop && (generation == VideoWorkerGeneration
+		|| !VideoWorkerJob)) {
+	    generation = VideoWorkerGeneration;
+	    pthread_cond_wait(&VideoWorkerCond, &VideoWorkerMutex);
+	}
+	if (VideoWorkerStop) {
+	    break;
+	}
+	generation = VideoWorkerGeneration;
+	job = VideoWorkerJob;
+	++VideoWorkerBusy;
+	pthread_mutex_unlock(&VideoWorkerMutex);
+
+	VideoConvertBands(job);
+
+	pthread_mutex_lock(&VideoWorkerMutex);
+	if (!--VideoWorkerBusy) {
+	    pthread_cond_signal(&VideoWorkerDoneCond);
+	}
+    }
+    pthread_mutex_unlock(&VideoWorkerMutex);
+    return NULL;
+}
+
+///
+///	Convert ARGB image into the native image format, in parallel.
+///
+///	Big images are split into row bands, which are converted by the
+///	workers and the calling thread.  Small images are converted by the
+///	calling thread only.
+///
+///	@param dst	output image
+///	@param stride	bytes per row of @p dst
+///	@param src	input argb image, rows are @p w pixels
+///	@param w	width of image
+///	@param h	height of image
+///
+static void VideoConvertRectParallel(uint8_t * dst, unsigned stride,
+    const uint32_t * src, int w, int h)
+{
+    VideoConvertJob job;
+
+    if (!VideoWorkerN || w * h < VIDEO_WORKER_PIXELS) {
+	VideoConvertRect(dst, stride, src, w, h);
+	return;
+    }
+
+    job.Dst = dst;
+    job.Stride = stride;
+    job.Src = src;
+    job.Width = w;
+    job.Height = h;
+    // some bands more than threads, for balance
+    job.Bands = 2 * (VideoWorkerN + 1);
+    job.BandRows = (h + job.Bands - 1) / job.Bands;
+    job.Bands = (h + job.BandRows - 1) / job.BandRows;
+    job.NextBand = 0;
+    job.DoneBands = 0;
+
+    pthread_mutex_lock(&VideoWorkerMutex);
+    VideoWorkerJob = &job;
+    ++VideoWorkerGeneration;
+    pthread_cond_broadcast(&VideoWorkerCond);
+    pthread_mutex_unlock(&VideoWorkerMutex);
+
+    VideoConvertBands(&job);
+
+    // job is on the stack, wait until no worker uses it
+    pthread_mutex_lock(&VideoWorkerMutex);
+    VideoWorkerJob = NULL;
+    while (__atomic_load_n(&job.DoneBands, __ATOMIC_ACQUIRE) < job.Bands
+	|| VideoWorkerBusy) {
+	pthread_cond_wait(&VideoWorkerDoneCond, &VideoWorkerMutex);
+    }
+    pthread_mutex_unlock(&VideoWorkerMutex);
+}
+
+///
+///	Start conversion worker threads.
+///
+///	One thread less than cpus online, the video thread works too.
+///
+static void VideoWorkerInit(void)
+{
+    long cpus;
+    int i;
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    VideoWorkerStop = 0;
+    VideoWorkerN = 0;
+    for (i = 0; i < cpus - 1 && i < VIDEO_WORKER_MAX; ++i) {
+	if (pthread_create(&VideoWorker[i], NULL, VideoWorkerHandler, NULL)) {
+	    Error(_("video: can't create worker thread\n"));
+	    break;
+	}
+#ifdef HAVE_PTHREAD_NAME
+	pthread_setname_np(VideoWorker[i], "play worker");
+#endif
+	++VideoWorkerN;
+    }
+    Debug(3, "video: %d conversion workers\n", VideoWorkerN);
+}
+
+///
+///	Stop conversion worker threads.
+///
+static void VideoWorkerExit(void)
+{
+    int i;
+
+    pthread_mutex_lock(&VideoWorkerMutex);
+    VideoWorkerStop = 1;
+    pthread_cond_broadcast(&VideoWorkerCond);
+    pthread_mutex_unlock(&VideoWorkerMutex);
+    for (i = 0; i < VideoWorkerN; ++i) {
+	pthread_join(VideoWorker[i], NULL);
+    }
+    VideoWorkerN = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//	Scroll
+//////////////////////////////////////////////////////////////////////////////
+
+    /// Minimal rows of a draw to check for scrolling.
+#define VIDEO_SCROLL_ROWS_MIN 64
+
+    /// Maximal tried scroll distances per draw.
+#define VIDEO_SCROLL_TRIES 64
+
+static uint64_t *VideoScrollHashes;	///< reusable row hashes of scroll
+static size_t VideoScrollHashN;		///< allocated row hashes
+
+///
+///	Check if an area can be scrolled in the backing pixmap.
+///
+///	The surface of all tiles touched by the area must match the
+///	pixmap, no pending damage may be inside them.
+///
+///	@param x	x position of area
+///	@param y	y position of area
+///	@param w	width of area
+///	@param h	height of area
+///
+static int VideoScrollPossible(int x, int y, int w, int h)
+{
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+    int i;
+
+    x1 = x / VIDEO_TILE_SIZE * VIDEO_TILE_SIZE;
+    y1 = y / VIDEO_TILE_SIZE * VIDEO_TILE_SIZE;
+    x2 = (x + w + VIDEO_TILE_SIZE - 1) / VIDEO_TILE_SIZE * VIDEO_TILE_SIZE;
+    y2 = (y + h + VIDEO_TILE_SIZE - 1) / VIDEO_TILE_SIZE * VIDEO_TILE_SIZE;
+    for (i = 0; i < VideoDamageN; ++i) {
+	const xcb_rectangle_t *rect;
+
+	rect = VideoDamage + i;
+	if (rect->x < x2 && rect->x + rect->width > x1 && rect->y < y2
+	    && rect->y + rect->height > y1) {
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+///
+///	Count rows matching for a scroll distance.
+///
+///	@param old	row hashes of old content
+///	@param cur	row hashes of new content
+///	@param h	number of rows
+///	@param d	scroll distance, new row i is old row i + d
+///
+static int VideoScrollMatch(const uint64_t * old, const uint64_t * cur, int h,
+    int d)
+{
+    int count;
+    int i;
+
+    count = 0;
+    for (i = d < 0 ? -d : 0; i < h && i + d < h; ++i) {
+	count += cur[i] == old[i + d];
+    }
+    return count;
+}
+
+///
+///	Detect vertical scrolling between old and new content.
+///
+///	Some sample rows of the new content are searched in the old
+///	content, each found offset is rated by the number of matching
+///	rows.
+///
+///	@param old	row hashes of old content
+///	@param cur	row hashes of new content
+///	@param h	number of rows
+///
+///	@returns scroll distance, new row i is old row i + distance.
+///
+static int VideoScrollDetect(const uint64_t * old, const uint64_t * cur,
+    int h)
+{
+    int best;
+    int best_count;
+    int tries;
+    int s;
+
+    best = 0;
+    best_count = VideoScrollMatch(old, cur, h, 0);
+    tries = 0;
+    for (s = 1; s < 4; ++s) {
+	int m;
+	int j;
+
+	m = h * s / 4;
+	for (j = 0; j < h && tries < VIDEO_SCROLL_TRIES; ++j) {
+	    int count;
+
+	    if (j == m || old[j] != cur[m]) {
+		continue;
+	    }
+	    ++tries;
+	    count = VideoScrollMatch(old, cur, h, j - m);
+	    if (count > best_count) {
+		best = j - m;
+		best_count = count;
+	    }
+	}
+    }
+    // most of the moved rows must match
+    if (best && best_count >= (h - abs(best)) * 3 / 4) {
+	return best;
+    }
+    return 0;
+}
+
+///
+///	Scroll the old content of an area to the new content.
+///
+///	If the new image is the old content shifted vertically, the old
+///	content is moved with copy area in the backing pixmap and in the
+///	surface.  The tile hashes are updated, so drawing the new image
+///	only uploads the newly visible rows.
+///
+///	@param x	x position of area
+///	@param y	y position of area
+///	@param w	width of area
+///	@param h	height of area
+///	@param image	new content in native format, rows are packed
+///
+static void VideoOsdScroll(int x, int y, int w, int h, const uint8_t * image)
+{
+    xcb_rectangle_t rect;
+    uint64_t *hashes;
+    unsigned bytes;
+    unsigned tx;
+    unsigned ty;
+    int sy;
+    int d;
+    int i;
+
+    bytes = w * VideoBitsPerPixel / 8;
+    // old and new row hashes, buffer only grows
+    if ((size_t) (2 * h) > VideoScrollHashN) {
+	free(VideoScrollHashes);
+	if (!(VideoScrollHashes =
+		malloc(2 * h * sizeof(*VideoScrollHashes)))) {
+	    Fatal(_("video: out of memory\n"));
+	}
+	VideoScrollHashN = 2 * h;
+    }
+    hashes = VideoScrollHashes;
+    for (i = 0; i < h; ++i) {
+	hashes[i] =
+	    VideoHashBytes(0, VideoOsdSurface + (y + i) * VideoOsdStride +
+	    x * VideoBitsPerPixel / 8, bytes);
+	hashes[h + i] = VideoHashBytes(0, image + i * bytes, bytes);
+    }
+    d = VideoScrollDetect(hashes, hashes + h, h);
+    if (!d) {
+	return;
+    }
+    Debug(4, "video: scroll %dx%d%+d%+d by %d rows\n", w, h, x, y, d);
+
+    rect.x = x;
+    rect.y = d > 0 ? y : y - d;
+    rect.width = w;
+    rect.height = h - abs(d);
+    sy = rect.y + d;
+    xcb_copy_area(Connection, VideoOsdPixmap, VideoOsdPixmap, VideoOsdGC, x,
+	sy, x, rect.y, w, rect.height);
+    // same move in the surface, in the direction not overwriting sources
+    for (i = 0; i < rect.height; ++i) {
+	int r;
+
+	r = d > 0 ? i : rect.height - 1 - i;
+	memcpy(VideoOsdSurface + (rect.y + r) * VideoOsdStride +
+	    x * VideoBitsPerPixel / 8,
+	    VideoOsdSurface + (sy + r) * VideoOsdStride +
+	    x * VideoBitsPerPixel / 8, bytes);
+    }
+    // surface and pixmap match again in all touched tiles
+    for (ty = rect.y / VIDEO_TILE_SIZE;
+	ty * VIDEO_TILE_SIZE < (unsigned)rect.y + rect.height; ++ty) {
+	for (tx = rect.x / VIDEO_TILE_SIZE;
+	    tx * VIDEO_TILE_SIZE < (unsigned)rect.x + rect.width; ++tx) {
+	    VideoTileHash[ty * VideoTilesX + tx] = VideoTileHashCalc(tx, ty);
+	}
+    }
+    if (VideoShape) {
+	VideoShapeArea(&rect);
+    }
+    VideoOsdPresent(rect.x, rect.y, rect.width, rect.height);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	Draw a ARGB image into the osd surface.
+///
+///	The image must be clipped to the window, it is uploaded with the
+///	next VideoOsdUpload().
+///
+///	@param x	x position of image in osd
+///	@param y	y position of image in osd
+///	@param w	width of image
+///	@param h	height of image
+///	@param src	argb image, rows are @p w pixels
+///
+static void VideoOsdDrawARGB(int x, int y, int w, int h,
+    const uint32_t * src)
+{
+    uint8_t *dst;
+
+    if (!VideoOsdSurface) {
+	return;
+    }
+    VideoShmSync();
+
+    dst = VideoOsdSurface + y * VideoOsdStride + x * VideoBitsPerPixel / 8;
+    if (h >= VIDEO_SCROLL_ROWS_MIN && VideoScrollPossible(x, y, w, h)) {
+	uint8_t *image;
+	unsigned bytes;
+	unsigned size;
+	int i;
+
+	// convert aside, old content is needed for scroll detection
+	bytes = w * VideoBitsPerPixel / 8;
+	size = (h * bytes + 3) & ~3U;
+	image = VideoImageAlloc(size);
+	VideoConvertRectParallel(image, bytes, src, w, h);
+	VideoOsdScroll(x, y, w, h, image);
+	for (i = 0; i < h; ++i) {
+	    memcpy(dst + i * VideoOsdStride, image + i * bytes, bytes);
+	}
+    } else {
+	VideoConvertRectParallel(dst, VideoOsdStride, src, w, h);
+    }
+
+    VideoDamageAdd(x, y, w, h);
+}
+
+///
+///	Draw a palette indexed image into the osd surface.
+///
+///	The palette is converted once into a lookup table of surface
+///	pixels, with the transparency already applied.  Rows are expanded
+///	through the table into the osd surface.
+///
+///	@param x	x position of image in osd
+///	@param y	y position of image in osd
+///	@param w	width of image
+///	@param h	height of image
+///	@param index	palette indexes of image
+///	@param stride	bytes per row of @p index
+///	@param palette	ARGB colors of palette
+///	@param colors	number of colors in @p palette, at most 256
+///
+static void VideoOsdDrawIndexed(int x, int y, int w, int h,
+    const uint8_t * index, int stride, const uint32_t * palette, int colors)
+{
+    uint32_t lut[256];
+    uint32_t *row;
+    int i;
+
+    if (!VideoOsdSurface) {
+	return;
+    }
+    // unused entries are transparent
+    VideoConvertRow(lut, palette, colors, VideoOsdKey);
+    for (i = colors; i < 256; ++i) {
+	lut[i] = VideoOsdKey;
+    }
+
+    VideoShmSync();
+
+    // other formats expand into a row and pack it
+    row = VideoPackRow ? (uint32_t *) VideoImageAlloc(w * sizeof(*row)) :
+	NULL;
+    for (i = 0; i < h; ++i) {
+	const uint8_t *src;
+	uint8_t *dst;
+	uint32_t *out;
+	int j;
+
+	src = index + i * stride;
+	dst =
+	    VideoOsdSurface + (y + i) * VideoOsdStride +
+	    x * VideoBitsPerPixel / 8;
+	out = row ? row : (uint32_t *) dst;
+	for (j = 0; j < w; ++j) {
+	    out[j] = lut[src[j]];
+	}
+	if (row) {
+	    VideoPackRow(dst, row, w);
+	}
+    }
+
+    VideoDamageAdd(x, y, w, h);
 }
 
 static xcb_key_symbols_t *XcbKeySymbols;	///< Keyboard symbols
@@ -446,104 +2446,971 @@ static void VideoKeyPress(const xcb_key_press_event_t * event)
 	    FeedKeyPress("XKeySym", "AudioNext", 0, 0);
 	    break;
 
-	default:
-	    Debug(3, "play/event: keycode %d\n", event->detail);
-	    break;
+	default:
+	    Debug(3, "play/event: keycode %d\n", event->detail);
+	    break;
+
+    }
+}
+
+///
+///	Keep the top-level argb osd window over the play window.
+///
+///	The play window can be moved and restacked by the window manager.
+///
+static void VideoOsdFollow(void)
+{
+    xcb_translate_coordinates_reply_t *reply;
+    uint32_t values[3];
+
+    if (!VideoArgb) {			// osd is a child of the play window
+	return;
+    }
+    reply =
+	xcb_translate_coordinates_reply(Connection,
+	xcb_translate_coordinates(Connection, VideoPlayWindow,
+	    VideoScreen->root, 0, 0), NULL);
+    if (!reply) {
+	return;
+    }
+    values[0] = reply->dst_x;
+    values[1] = reply->dst_y;
+    values[2] = XCB_STACK_MODE_ABOVE;
+    xcb_configure_window(Connection, VideoOsdWindow,
+	XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
+	XCB_CONFIG_WINDOW_STACK_MODE, values);
+    free(reply);
+}
+
+///
+///	Handle video event.
+///
+///	@param event	xcb event or error
+///
+static void VideoHandleEvent(const xcb_generic_event_t * event)
+{
+    switch (XCB_EVENT_RESPONSE_TYPE(event)) {
+	case XCB_EXPOSE:
+	    // repaint osd from backing pixmap, play window has background
+	    if (((xcb_expose_event_t *) event)->window == VideoOsdWindow) {
+		const xcb_expose_event_t *expose;
+
+		expose = (xcb_expose_event_t *) event;
+		VideoOsdPresentWindow(expose->x, expose->y, expose->width,
+		    expose->height);
+		// flushed by video thread
+	    }
+	    break;
+	case XCB_CONFIGURE_NOTIFY:
+	    if (((xcb_configure_notify_event_t *) event)->window ==
+		VideoPlayWindow) {
+		VideoOsdFollow();
+	    }
+	    break;
+	case XCB_MAP_NOTIFY:
+	    Debug(3, "video/event: MapNotify\n");
+	    if (((xcb_map_notify_event_t *) event)->window == VideoPlayWindow) {
+		VideoOsdFollow();
+	    }
+	    // hide cursor after mapping
+	    xcb_change_window_attributes(Connection, VideoOsdWindow,
+		XCB_CW_CURSOR, &VideoBlankCursor);
+	    xcb_change_window_attributes(Connection, VideoPlayWindow,
+		XCB_CW_CURSOR, &VideoBlankCursor);
+	    break;
+	case XCB_DESTROY_NOTIFY:
+	    break;
+	case XCB_KEY_PRESS:
+	    VideoKeyPress((xcb_key_press_event_t *) event);
+	    break;
+	case XCB_KEY_RELEASE:
+	case XCB_BUTTON_PRESS:
+	case XCB_BUTTON_RELEASE:
+	    break;
+	case XCB_MOTION_NOTIFY:
+	    break;
+
+	case 0:
+	    // error_code
+	    Debug(3, "play/event: error %x\n", event->response_type);
+	    break;
+	default:
+	    // unknown event type, ignore it
+	    Debug(3, "play/event: unknown %x\n", event->response_type);
+	    break;
+    }
+}
+
+///
+///	Handle all pending video events.
+///
+static void VideoHandleEvents(void)
+{
+    xcb_generic_event_t *event;
+
+    while ((event = xcb_poll_for_event(Connection))) {
+	VideoHandleEvent(event);
+	free(event);
+    }
+}
+
+    /// Bytes per put image stripe, limits blocking of event handling.
+#define VIDEO_STRIPE_BYTES (128 * 1024)
+
+///
+///	Get rows per put image stripe.
+///
+///	Stripes fit into the maximal request length of the server and
+///	are small enough, that events are handled between them.
+///
+///	@param width	width of stripe
+///
+static int VideoStripeRows(int width)
+{
+    size_t stride;
+    size_t rows;
+
+    stride =
+	((width * VideoBitsPerPixel + VideoScanlinePad -
+	    1) / VideoScanlinePad) * VideoScanlinePad / 8;
+    rows = (VideoMaxRequestBytes - sizeof(xcb_put_image_request_t)) / stride;
+    if (rows > VIDEO_STRIPE_BYTES / stride) {
+	rows = VIDEO_STRIPE_BYTES / stride;
+    }
+    if (rows > VIDEO_PUT_ROWS_MAX) {
+	rows = VIDEO_PUT_ROWS_MAX;
+    }
+    return rows ? rows : 1;
+}
+
+///
+///	Upload all osd changes since last upload.
+///
+///	Only the tiles of the damaged areas, whose content differs from
+///	the backing pixmap, are uploaded.  Solid tiles are filled by the
+///	server.  All changes are presented and the connection is flushed
+///	once.
+///
+static void VideoOsdUpload(void)
+{
+    xcb_rectangle_t damage[VIDEO_DAMAGE_MAX];
+    int n;
+    int i;
+
+    // damage is rebuilt from the changed tiles
+    n = VideoDamageN;
+    memcpy(damage, VideoDamage, n * sizeof(*damage));
+    VideoDamageN = 0;
+    for (i = 0; i < n; ++i) {
+	VideoTileDamage(damage + i);
+    }
+    if (VideoShape) {
+	VideoShapeUpdate();
+    }
+
+    for (i = 0; i < VideoDamageN; ++i) {
+	xcb_rectangle_t stripe;
+	int rows;
+	int y;
+
+	stripe = VideoDamage[i];
+	rows = VideoStripeRows(stripe.width);
+	if (VideoShmSeg != XCB_NONE) {	// shared memory request is small
+	    rows = stripe.height;
+	}
+	for (y = 0; y < VideoDamage[i].height; y += rows) {
+	    stripe.y = VideoDamage[i].y + y;
+	    stripe.height = VideoDamage[i].height - y;
+	    if (stripe.height > rows) {
+		stripe.height = rows;
+	    }
+	    VideoUploadRect(&stripe);
+	    // keys are handled while big images are written
+	    VideoHandleEvents();
+	}
+    }
+    // damage becomes the area to present
+    VideoFillRects();
+    for (i = 0; i < VideoDamageN; ++i) {
+	VideoOsdPresent(VideoDamage[i].x, VideoDamage[i].y,
+	    VideoDamage[i].width, VideoDamage[i].height);
+    }
+    VideoDamageN = 0;
+    if (VideoOsdMapPending) {
+	// expose presents the backing pixmap
+	xcb_map_window(Connection, VideoOsdWindow);
+	VideoOsdMapPending = 0;
+    }
+    xcb_flush(Connection);
+}
+
+///
+///	Clear osd surface.
+///
+///	The backing pixmap keeps the old content, the tile hashes find the
+///	differences to it with the next upload.  Drawing the same osd
+///	again uploads nothing.
+///
+static void VideoOsdClear(void)
+{
+    if (!VideoOsdSurface) {
+	return;
+    }
+    VideoShmSync();
+    VideoOsdSurfaceFill();
+    VideoDamageN = 0;
+    VideoDamageAdd(0, 0, VideoOsdWidth, VideoOsdHeight);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//	Thread
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	OSD update types.
+///
+typedef enum _video_osd_update_type_
+{
+    VideoUpdateDrawARGB,		///< draw argb image
+    VideoUpdateDrawIndexed,		///< draw palette indexed image
+    VideoUpdateFlush,			///< upload changes
+    VideoUpdateShow,			///< map osd window
+    VideoUpdateHide,			///< unmap osd window
+    VideoUpdateClear,			///< clear osd window
+} VideoOsdUpdateType;
+
+///
+///	OSD update descriptor.
+///
+///	Descriptors are immutable after they are queued.  Only
+///	#VideoOsdUpdate::Superseded is set later by the producer.  Each
+///	queue slot keeps its descriptor and image buffer, the buffer only
+///	grows and is reused when the slot is recycled.  An image handed over
+///	by the caller is used instead of the buffer and released, when the
+///	slot is processed.
+///
+typedef struct _video_osd_update_
+{
+    VideoOsdUpdateType Type;		///< update type
+    int Superseded;			///< later update covers this draw
+    int X;				///< x position of image in osd
+    int Y;				///< y position of image in osd
+    int Width;				///< width of image
+    int Height;				///< height of image
+    int Colors;				///< palette colors of indexed image
+    uint8_t *Data;			///< image data (and palette)
+    size_t DataSize;			///< allocated bytes of image data
+    const uint8_t *Image;		///< handed over image, NULL = Data
+    VideoReleaseFunc *Release;		///< release of handed over image
+    void *Opaque;			///< argument of release
+} VideoOsdUpdate;
+
+    /// Number of queued osd updates, must be a power of 2.
+#define VIDEO_QUEUE_SIZE 256
+
+    /// Single producer, single consumer ring of osd updates.
+static VideoOsdUpdate VideoQueue[VIDEO_QUEUE_SIZE];
+static unsigned VideoQueueWrite;	///< producer index of queue
+static unsigned VideoQueueRead;		///< consumer index of queue
+
+///
+///	OSD updates merged while the queue is full.
+///
+///	The producer never waits for the video thread.  If the queue is
+///	full, this and all following updates are merged into an argb canvas
+///	of the osd, until the video thread takes it over.
+///
+typedef struct _video_osd_overflow_
+{
+    uint32_t *Canvas;			///< argb canvas, osd width pixels stride
+    int X1;				///< left of drawn area
+    int Y1;				///< top of drawn area
+    int X2;				///< right of drawn area, exclusive
+    int Y2;				///< bottom of drawn area, exclusive
+    char Clear;				///< osd cleared before drawn area
+    signed char Show;			///< 1 show, -1 hide, 0 unchanged
+    char Flush;				///< upload after drawn area
+    unsigned Merged;			///< number of merged updates
+} VideoOsdOverflow;
+
+static VideoOsdOverflow VideoOverflow;	///< updates merged by producer
+static uint32_t *VideoOverflowSpare;	///< canvas owned by video thread
+static char VideoOverflowActive;	///< updates go to overflow, not queue
+
+    /// Lock of #VideoOverflow, the video thread only swaps the canvas.
+static pthread_mutex_t VideoOverflowMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t VideoThread;		///< video thread
+static char VideoThreadRunning;		///< video thread is running
+static char VideoThreadExited;		///< video thread left its loop
+static volatile char VideoThreadStop;	///< request video thread stop
+static int VideoWakeupFd = -1;		///< eventfd to wakeup video thread
+
+///
+///	Wakeup video thread.
+///
+static void VideoThreadWakeup(void)
+{
+    uint64_t one;
+
+    one = 1;
+    if (write(VideoWakeupFd, &one, sizeof(one)) != sizeof(one)) {
+	Error(_("video: wakeup failed: %s\n"), strerror(errno));
+    }
+}
+
+///
+///	Check if the video thread takes osd updates.
+///
+///	If the thread exited (x11 connection lost), updates are dropped.
+///
+static int VideoQueueActive(void)
+{
+    return VideoThreadRunning
+	&& !__atomic_load_n(&VideoThreadExited, __ATOMIC_ACQUIRE);
+}
+
+///
+///	Get the next free osd update slot of the queue.
+///
+///	Called only from the thread flushing the osd (VDR serializes osd
+///	access).  The image buffer of the slot is reused, it only grows.
+///
+///	@param type	update type
+///	@param size	bytes of image data
+///
+///	@returns slot to fill and queue with VideoQueueUpdate(), NULL if
+///	the queue is full or updates are merged, the update must be merged
+///	with the VideoOverflow functions then.
+///
+static VideoOsdUpdate *VideoQueueSlot(VideoOsdUpdateType type, size_t size)
+{
+    VideoOsdUpdate *update;
+
+    // merged updates keep their order, queue only after the merge
+    if (__atomic_load_n(&VideoOverflowActive, __ATOMIC_ACQUIRE)
+	|| VideoQueueWrite - __atomic_load_n(&VideoQueueRead,
+	    __ATOMIC_ACQUIRE) >= VIDEO_QUEUE_SIZE) {
+	return NULL;
+    }
+
+    update = &VideoQueue[VideoQueueWrite & (VIDEO_QUEUE_SIZE - 1)];
+    if (size > update->DataSize) {
+	free(update->Data);
+	if (!(update->Data = malloc(size))) {
+	    Fatal(_("video: out of memory\n"));
+	}
+	update->DataSize = size;
+    }
+    update->Type = type;
+    update->Superseded = 0;
+    update->Image = NULL;
+    update->Release = NULL;
+    return update;
+}
+
+///
+///	Queue an osd update for the video thread.
+///
+///	Queued draws, which are completely covered by a new draw, are
+///	marked superseded and skipped by the video thread.
+///
+///	@param update	osd update slot from VideoQueueSlot()
+///
+static void VideoQueueUpdate(const VideoOsdUpdate * update)
+{
+    unsigned read;
+    unsigned i;
+
+    read = __atomic_load_n(&VideoQueueRead, __ATOMIC_ACQUIRE);
+
+    // mark older draws of the same region superseded
+    if (update->Type == VideoUpdateDrawARGB
+	|| update->Type == VideoUpdateDrawIndexed) {
+	for (i = read; i != VideoQueueWrite; ++i) {
+	    VideoOsdUpdate *old;
+
+	    old = &VideoQueue[i & (VIDEO_QUEUE_SIZE - 1)];
+	    if ((old->Type == VideoUpdateDrawARGB
+		    || old->Type == VideoUpdateDrawIndexed)
+		&& old->X >= update->X && old->Y >= update->Y
+		&& old->X + old->Width <= update->X + update->Width
+		&& old->Y + old->Height <= update->Y + update->Height) {
+		__atomic_store_n(&old->Superseded, 1, __ATOMIC_RELAXED);
+	    }
+	}
+    }
+    __atomic_store_n(&VideoQueueWrite, VideoQueueWrite + 1,
+	__ATOMIC_RELEASE);
+}
+
+///
+///	Reset merged osd updates, keeps the canvas.
+///
+static void VideoOverflowReset(void)
+{
+    VideoOverflow.X1 = 0;
+    VideoOverflow.Y1 = 0;
+    VideoOverflow.X2 = 0;
+    VideoOverflow.Y2 = 0;
+    VideoOverflow.Clear = 0;
+    VideoOverflow.Show = 0;
+    VideoOverflow.Flush = 0;
+    VideoOverflow.Merged = 0;
+}
+
+///
+///	Start merging an osd update.
+///
+///	@returns argb canvas of osd, locked until VideoOverflowEnd().
+///
+static uint32_t *VideoOverflowBegin(void)
+{
+    pthread_mutex_lock(&VideoOverflowMutex);
+    if (!VideoOverflow.Canvas) {
+	if (!(VideoOverflow.Canvas =
+		malloc(VideoOsdWidth * VideoOsdHeight *
+		    sizeof(*VideoOverflow.Canvas)))) {
+	    Fatal(_("video: out of memory\n"));
+	}
+    }
+    ++VideoOverflow.Merged;
+    return VideoOverflow.Canvas;
+}
+
+///
+///	Finish merging an osd update, the video thread takes it over.
+///
+static void VideoOverflowEnd(void)
+{
+    __atomic_store_n(&VideoOverflowActive, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&VideoOverflowMutex);
+    VideoThreadWakeup();
+}
+
+///
+///	Add an area to the drawn area of the merged updates.
+///
+static void VideoOverflowArea(int x, int y, int w, int h)
+{
+    if (VideoOverflow.X1 == VideoOverflow.X2) {	// empty
+	VideoOverflow.X1 = x;
+	VideoOverflow.Y1 = y;
+	VideoOverflow.X2 = x + w;
+	VideoOverflow.Y2 = y + h;
+	return;
+    }
+    if (x < VideoOverflow.X1) {
+	VideoOverflow.X1 = x;
+    }
+    if (y < VideoOverflow.Y1) {
+	VideoOverflow.Y1 = y;
+    }
+    if (x + w > VideoOverflow.X2) {
+	VideoOverflow.X2 = x + w;
+    }
+    if (y + h > VideoOverflow.Y2) {
+	VideoOverflow.Y2 = y + h;
+    }
+}
+
+///
+///	Merge an osd command.
+///
+///	A clear discards the drawn area, the last show or hide wins.
+///
+///	@param type	command update type
+///
+static void VideoOverflowCommand(VideoOsdUpdateType type)
+{
+    VideoOverflowBegin();
+    switch (type) {
+	case VideoUpdateFlush:
+	    VideoOverflow.Flush = 1;
+	    break;
+	case VideoUpdateShow:
+	    VideoOverflow.Show = 1;
+	    break;
+	case VideoUpdateHide:
+	    VideoOverflow.Show = -1;
+	    break;
+	case VideoUpdateClear:
+	    VideoOverflow.X1 = 0;
+	    VideoOverflow.Y1 = 0;
+	    VideoOverflow.X2 = 0;
+	    VideoOverflow.Y2 = 0;
+	    VideoOverflow.Clear = 1;
+	    break;
+	default:
+	    break;
+    }
+    VideoOverflowEnd();
+}
+
+///
+///	Queue osd command and wakeup video thread.
+///
+///	@param type	command update type
+///
+static void VideoQueueCommand(VideoOsdUpdateType type)
+{
+    VideoOsdUpdate *update;
+
+    if (!VideoQueueActive()) {
+	Debug(3, "play: FIXME: must restore osd provider\n");
+	return;
+    }
+    if (!(update = VideoQueueSlot(type, 0))) {
+	VideoOverflowCommand(type);
+	return;
+    }
+    VideoQueueUpdate(update);
+    VideoThreadWakeup();
+}
+
+///
+///	Handle all queued osd updates.
+///
+static void VideoProcessQueue(void)
+{
+    unsigned write;
+
+    write = __atomic_load_n(&VideoQueueWrite, __ATOMIC_ACQUIRE);
+    while (VideoQueueRead != write) {
+	VideoOsdUpdate *update;
+
+	update = &VideoQueue[VideoQueueRead & (VIDEO_QUEUE_SIZE - 1)];
+	switch (update->Type) {
+	    case VideoUpdateDrawARGB:
+		if (!__atomic_load_n(&update->Superseded, __ATOMIC_RELAXED)) {
+		    VideoOsdDrawARGB(update->X, update->Y, update->Width,
+			update->Height,
+			(const uint32_t *)(update->Image ? update->Image :
+			    update->Data));
+		}
+		break;
+	    case VideoUpdateDrawIndexed:
+		if (!__atomic_load_n(&update->Superseded, __ATOMIC_RELAXED)) {
+		    // palette follows the index rows
+		    VideoOsdDrawIndexed(update->X, update->Y, update->Width,
+			update->Height, update->Data, update->Width,
+			(const uint32_t *)(update->Data +
+			    update->Width * update->Height), update->Colors);
+		}
+		break;
+	    case VideoUpdateFlush:
+		VideoOsdUpload();
+		break;
+	    case VideoUpdateShow:
+		// map with the next upload, no stale osd is shown
+		VideoOsdMapPending = 1;
+		break;
+	    case VideoUpdateHide:
+		VideoOsdMapPending = 0;
+		xcb_unmap_window(Connection, VideoOsdWindow);
+		break;
+	    case VideoUpdateClear:
+		VideoOsdClear();
+		break;
+	}
+	if (update->Release) {		// also superseded images
+	    update->Release(update->Opaque);
+	}
+	// slot and its image buffer are reused by the producer
+	__atomic_store_n(&VideoQueueRead, VideoQueueRead + 1,
+	    __ATOMIC_RELEASE);
+    }
+}
+
+///
+///	Handle the osd updates merged while the queue was full.
+///
+///	The producer queues nothing while updates are merged, the queue
+///	is processed first.  The canvas is swapped under the lock, the
+///	producer never waits for the drawing.
+///
+static void VideoProcessOverflow(void)
+{
+    VideoOsdOverflow pending;
+
+    if (!__atomic_load_n(&VideoOverflowActive, __ATOMIC_ACQUIRE)) {
+	return;
+    }
+    VideoProcessQueue();
+
+    pthread_mutex_lock(&VideoOverflowMutex);
+    pending = VideoOverflow;
+    VideoOverflow.Canvas = VideoOverflowSpare;
+    VideoOverflowReset();
+    __atomic_store_n(&VideoOverflowActive, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&VideoOverflowMutex);
+    VideoOverflowSpare = pending.Canvas;
+
+    Debug(3, "video: %u osd updates merged, queue was full\n",
+	pending.Merged);
+    if (pending.Clear) {
+	VideoOsdClear();
+    }
+    if (pending.Show > 0) {
+	VideoOsdMapPending = 1;
+    } else if (pending.Show < 0) {
+	VideoOsdMapPending = 0;
+	xcb_unmap_window(Connection, VideoOsdWindow);
+    }
+    if (pending.X1 < pending.X2 && pending.Y1 < pending.Y2) {
+	int w;
+	int h;
+	int i;
+
+	// pack the drawn rows, no row overwrites a row not yet moved
+	w = pending.X2 - pending.X1;
+	h = pending.Y2 - pending.Y1;
+	for (i = 0; i < h; ++i) {
+	    memmove(pending.Canvas + i * w,
+		pending.Canvas + (pending.Y1 + i) * VideoOsdWidth +
+		pending.X1, w * sizeof(*pending.Canvas));
+	}
+	VideoOsdDrawARGB(pending.X1, pending.Y1, w, h, pending.Canvas);
+    }
+    if (pending.Flush) {
+	VideoOsdUpload();
+    }
+}
+
+///
+///	Video thread.
+///
+///	Owns the xcb connection: handles the osd updates and the x11
+///	events.  Sleeps until the connection or the wakeup eventfd becomes
+///	readable.
+///
+static void *VideoThreadHandler( __attribute__ ((unused))
+    void *dummy)
+{
+    struct pollfd fds[2];
+
+    Debug(3, "video: thread started\n");
+
+    fds[0].fd = xcb_get_file_descriptor(Connection);
+    fds[0].events = POLLIN | POLLPRI;
+    fds[1].fd = VideoWakeupFd;
+    fds[1].events = POLLIN;
+
+    while (!VideoThreadStop) {
+	VideoProcessQueue();
+	VideoProcessOverflow();
+
+	// round trips of queue processing may have queued events
+	VideoHandleEvents();
+	if (xcb_connection_has_error(Connection)) {
+	    Error(_("video: x11 connection lost\n"));
+	    break;
+	}
+	xcb_flush(Connection);
+
+	if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+	    Error(_("play/event: poll failed: %s\n"), strerror(errno));
+	    break;
+	}
+	if (fds[1].revents & POLLIN) {
+	    uint64_t count;
+
+	    if (read(VideoWakeupFd, &count, sizeof(count)) < 0) {
+		Error(_("video: wakeup failed: %s\n"), strerror(errno));
+	    }
+	}
+    }
+
+    // producers drop their updates from now on
+    __atomic_store_n(&VideoThreadExited, 1, __ATOMIC_RELEASE);
+    Debug(3, "video: thread stopped\n");
+    return NULL;
+}
+
+///
+///	Start video thread.
+///
+static void VideoThreadInit(void)
+{
+    VideoQueueWrite = 0;
+    VideoQueueRead = 0;
+    VideoThreadStop = 0;
+    VideoThreadExited = 0;
+    VideoOverflowActive = 0;
+    VideoOverflowReset();
+
+    if ((VideoWakeupFd = eventfd(0, EFD_CLOEXEC)) < 0) {
+	Error(_("video: eventfd failed: %s\n"), strerror(errno));
+	return;
+    }
+    if (pthread_create(&VideoThread, NULL, VideoThreadHandler, NULL)) {
+	Error(_("video: can't create thread\n"));
+	close(VideoWakeupFd);
+	VideoWakeupFd = -1;
+	return;
+    }
+#ifdef HAVE_PTHREAD_NAME
+    pthread_setname_np(VideoThread, "play video");
+#endif
+    VideoThreadRunning = 1;
+}
+
+///
+///	Stop video thread and free all queued osd updates.
+///
+static void VideoThreadExit(void)
+{
+    unsigned n;
+    int i;
+
+    if (VideoThreadRunning) {
+	VideoThreadStop = 1;
+	VideoThreadWakeup();
+	pthread_join(VideoThread, NULL);
+	VideoThreadRunning = 0;
+    }
+    if (VideoWakeupFd != -1) {
+	close(VideoWakeupFd);
+	VideoWakeupFd = -1;
+    }
+    // images of unprocessed updates still belong to the queue
+    for (n = VideoQueueRead; n != VideoQueueWrite; ++n) {
+	VideoOsdUpdate *update;
 
+	update = &VideoQueue[n & (VIDEO_QUEUE_SIZE - 1)];
+	if (update->Release) {
+	    update->Release(update->Opaque);
+	}
     }
+    VideoQueueRead = VideoQueueWrite;
+    for (i = 0; i < VIDEO_QUEUE_SIZE; ++i) {
+	free(VideoQueue[i].Data);
+	VideoQueue[i].Data = NULL;
+	VideoQueue[i].DataSize = 0;
+    }
+    // canvas size depends on the osd size
+    free(VideoOverflow.Canvas);
+    VideoOverflow.Canvas = NULL;
+    free(VideoOverflowSpare);
+    VideoOverflowSpare = NULL;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+//	OSD
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	Draw a ARGB image.
 ///
-///	Poll video events.
+///	The visible part of the image is copied into the buffer of a queue
+///	slot, the caller frees the image after the call.
 ///
-///	@param timeout	timeout in milliseconds
+///	@param x	x position of image in osd
+///	@param y	y position of image in osd
+///	@param width	width of image
+///	@param height	height of image
+///	@param argb	argb image
 ///
-void VideoPollEvents(int timeout)
+void VideoDrawARGB(int x, int y, int width, int height, const uint8_t * argb)
 {
-    struct pollfd fds[1];
-    xcb_generic_event_t *event;
-    int n;
-    int delay;
+    VideoOsdUpdate *update;
+    int w;
+    int h;
+    int sx;
+    int sy;
+    int i;
 
-    if (!Connection) {
-	Debug(3, "play: poll without connection\n");
+    if (!VideoQueueActive()) {
+	Debug(3, "play: FIXME: must restore osd provider\n");
+	return;
+    }
+    // clip to window, the surface only covers the window
+    w = width;
+    h = height;
+    if (!VideoClip(&x, &y, &w, &h, &sx, &sy)) {
 	return;
     }
 
-    fds[0].fd = xcb_get_file_descriptor(Connection);
-    fds[0].events = POLLIN | POLLPRI;
-
-    delay = timeout;
-    for (;;) {
-	xcb_flush(Connection);
+    if (!(update = VideoQueueSlot(VideoUpdateDrawARGB, w * h * 4))) {
+	uint32_t *canvas;
 
-	// wait for events or timeout
-	if ((n = poll(fds, 1, delay)) <= 0) {
-	    // error or timeout
-	    if (n) {			// error
-		Error(_("play/event: poll failed: %s\n"), strerror(errno));
-	    }
-	    return;
+	canvas = VideoOverflowBegin();
+	for (i = 0; i < h; ++i) {
+	    memcpy(canvas + (y + i) * VideoOsdWidth + x,
+		argb + ((sy + i) * width + sx) * 4, w * 4);
 	}
-	if (fds[0].revents & (POLLIN | POLLPRI)) {
-	    if ((event = xcb_poll_for_event(Connection))) {
-
-		switch (XCB_EVENT_RESPONSE_TYPE(event)) {
-#if 0
-			// background pixmap no need to redraw
-		    case XCB_EXPOSE:
-			// collapse multi expose
-			if (!((xcb_expose_event_t *) event)->count) {
-			    xcb_clear_area(Connection, 0, Window, 0, 0, 64,
-				64);
-			    // flush the request
-			    xcb_flush(Connection);
-			}
-			break;
-#endif
-		    case XCB_MAP_NOTIFY:
-			Debug(3, "video/event: MapNotify\n");
-			// hide cursor after mapping
-			xcb_change_window_attributes(Connection,
-			    VideoOsdWindow, XCB_CW_CURSOR, &VideoBlankCursor);
-			xcb_change_window_attributes(Connection,
-			    VideoPlayWindow, XCB_CW_CURSOR, &VideoBlankCursor);
-			break;
-		    case XCB_DESTROY_NOTIFY:
-			return;
-		    case XCB_KEY_PRESS:
-			VideoKeyPress((xcb_key_press_event_t *) event);
-			break;
-		    case XCB_KEY_RELEASE:
-		    case XCB_BUTTON_PRESS:
-		    case XCB_BUTTON_RELEASE:
-			break;
-		    case XCB_MOTION_NOTIFY:
-			break;
-
-		    case 0:
-			// error_code
-			Debug(3, "play/event: error %x\n",
-			    event->response_type);
-			break;
-		    default:
-			// unknown event type, ignore it
-			Debug(3, "play/event: unknown %x\n",
-			    event->response_type);
-			break;
-		}
+	VideoOverflowArea(x, y, w, h);
+	VideoOverflowEnd();
+	return;
+    }
+    update->X = x;
+    update->Y = y;
+    update->Width = w;
+    update->Height = h;
+    for (i = 0; i < h; ++i) {
+	memcpy(update->Data + i * w * 4, argb + ((sy + i) * width + sx) * 4,
+	    w * 4);
+    }
+    VideoQueueUpdate(update);
+}
 
-		free(event);
-	    } else {
-		// no event, can happen, but we must check for close
-		if (xcb_connection_has_error(Connection)) {
-		    return;
-		}
+///
+///	Draw a ARGB image, handed over to the video thread.
+///
+///	Unlike VideoDrawARGB() the image isn't copied, the queue slot keeps
+///	it and the video thread calls @p release after drawing it.  An image
+///	clipped in width or a full queue is copied and released at once.
+///
+///	@param x	x position of image in osd
+///	@param y	y position of image in osd
+///	@param width	width of image
+///	@param height	height of image
+///	@param argb	argb image
+///	@param release	called with @p opaque, when the image is no longer used
+///	@param opaque	argument of @p release
+///
+void VideoDrawARGBImage(int x, int y, int width, int height,
+    const uint8_t * argb, VideoReleaseFunc * release, void *opaque)
+{
+    VideoOsdUpdate *update;
+    int w;
+    int h;
+    int sx;
+    int sy;
+
+    w = width;
+    h = height;
+    if (!VideoQueueActive() || !VideoClip(&x, &y, &w, &h, &sx, &sy)) {
+	release(opaque);
+	return;
+    }
+    // rows clipped in width aren't packed
+    if (w != width || !(update = VideoQueueSlot(VideoUpdateDrawARGB, 0))) {
+	VideoDrawARGB(x - sx, y - sy, width, height, argb);
+	release(opaque);
+	return;
+    }
+    update->X = x;
+    update->Y = y;
+    update->Width = w;
+    update->Height = h;
+    update->Image = argb + sy * width * 4;
+    update->Release = release;
+    update->Opaque = opaque;
+    VideoQueueUpdate(update);
+}
+
+///
+///	Draw a palette indexed image.
+///
+///	The visible part of the image and the palette are copied and queued
+///	for the video thread.
+///
+///	@param x	x position of image in osd
+///	@param y	y position of image in osd
+///	@param width	width of image
+///	@param height	height of image
+///	@param index	palette indexes of image
+///	@param stride	bytes per row of @p index
+///	@param palette	ARGB colors of palette
+///	@param colors	number of colors in @p palette
+///
+void VideoDrawIndexed(int x, int y, int width, int height,
+    const uint8_t * index, int stride, const uint32_t * palette, int colors)
+{
+    VideoOsdUpdate *update;
+    int w;
+    int h;
+    int sx;
+    int sy;
+    int i;
+
+    if (!VideoQueueActive()) {
+	Debug(3, "play: FIXME: must restore osd provider\n");
+	return;
+    }
+    w = width;
+    h = height;
+    if (!VideoClip(&x, &y, &w, &h, &sx, &sy)) {
+	return;
+    }
+    if (colors > 256) {
+	colors = 256;
+    }
+    // palette is stored behind the index rows
+    if (!(update =
+	    VideoQueueSlot(VideoUpdateDrawIndexed,
+		w * h + colors * sizeof(*palette)))) {
+	uint32_t *canvas;
+	int j;
+
+	// unused entries are transparent
+	canvas = VideoOverflowBegin();
+	for (i = 0; i < h; ++i) {
+	    const uint8_t *src;
+	    uint32_t *dst;
+
+	    src = index + (sy + i) * stride + sx;
+	    dst = canvas + (y + i) * VideoOsdWidth + x;
+	    for (j = 0; j < w; ++j) {
+		dst[j] = src[j] < colors ? palette[src[j]] : 0x00000000;
 	    }
 	}
+	VideoOverflowArea(x, y, w, h);
+	VideoOverflowEnd();
+	return;
+    }
+    update->X = x;
+    update->Y = y;
+    update->Width = w;
+    update->Height = h;
+    update->Colors = colors;
+    for (i = 0; i < h; ++i) {
+	memcpy(update->Data + i * w, index + (sy + i) * stride + sx, w);
     }
+    memcpy(update->Data + w * h, palette, colors * sizeof(*palette));
+    VideoQueueUpdate(update);
+}
+
+///
+///	Upload all osd changes since last flush.
+///
+void VideoOsdFlush(void)
+{
+    VideoQueueCommand(VideoUpdateFlush);
+}
+
+///
+///	Show window.
+///
+///	The window is mapped with the next flush.
+///
+void VideoWindowShow(void)
+{
+    VideoQueueCommand(VideoUpdateShow);
+}
+
+///
+///	Hide window.
+///
+void VideoWindowHide(void)
+{
+    VideoQueueCommand(VideoUpdateHide);
+}
+
+///
+///	Clear window.
+///
+///	The window keeps its content until the next flush, which only
+///	uploads the differences to the new content.
+///
+void VideoWindowClear(void)
+{
+    VideoQueueCommand(VideoUpdateClear);
 }
 
+//////////////////////////////////////////////////////////////////////////////
+
 ///
 ///	Get OSD size.
 ///
@@ -554,7 +3421,13 @@ void VideoGetOsdSize(int *width, int *height)
 {
     *width = 1920;
     *height = 1080;			// unknown default
-    if (VideoWindowWidth && VideoWindowHeight) {
+    if (VideoOsdWidth && VideoOsdHeight) {
+	*width = VideoOsdWidth;
+	*height = VideoOsdHeight;
+    } else if (VideoConfigOsdWidth && VideoConfigOsdHeight) {
+	*width = VideoConfigOsdWidth;	// not yet initialized
+	*height = VideoConfigOsdHeight;
+    } else if (VideoWindowWidth && VideoWindowHeight) {
 	*width = VideoWindowWidth;
 	*height = VideoWindowHeight;
     }
@@ -579,6 +3452,24 @@ void VideoSetGeometry(const char *geometry)
 	&VideoWindowX, &VideoWindowY);
 }
 
+///
+///	Set fixed osd size.
+///
+///	The osd has this size independent of the window size, it is scaled
+///	into the window.  Should be called before VideoInit().
+///
+///	@param size	osd size wxh
+///
+void VideoSetOsdSize(const char *size)
+{
+    if (sscanf(size, "%ux%u", &VideoConfigOsdWidth,
+	    &VideoConfigOsdHeight) != 2) {
+	Error(_("video: invalid osd size '%s'\n"), size);
+	VideoConfigOsdWidth = 0;
+	VideoConfigOsdHeight = 0;
+    }
+}
+
 ///
 ///	Set video color key.
 ///
@@ -589,6 +3480,296 @@ void VideoSetColorKey(uint32_t color_key)
     VideoColorKey = color_key;
 }
 
+///
+///	Set video osd argb mode.
+///
+///	The osd window is a top-level window with a 32 bit argb visual, the
+///	alpha channel is kept and the compositing manager blends the osd over
+///	the video.  Without a compositing manager, the color key is used.
+///	Should be called before VideoInit().
+///
+void VideoSetArgb(int on)
+{
+    VideoArgb = on;
+}
+
+///
+///	Set video osd shape mode.
+///
+///	Transparent osd pixels are cut out of the osd window with the X
+///	shape extension, the player needs no color key support.  Should be
+///	called before VideoInit().
+///
+void VideoSetShape(int on)
+{
+    VideoShape = on;
+}
+
+///
+///	Find render picture format by id.
+///
+///	@param formats	reply of render query picture formats
+///	@param id	picture format id
+///
+///	@returns picture format info, NULL if not found.
+///
+static const xcb_render_pictforminfo_t *VideoFindPictFormat(const
+    xcb_render_query_pict_formats_reply_t * formats,
+    xcb_render_pictformat_t id)
+{
+    xcb_render_pictforminfo_iterator_t iter;
+
+    iter = xcb_render_query_pict_formats_formats_iterator(formats);
+    for (; iter.rem; xcb_render_pictforminfo_next(&iter)) {
+	if (iter.data->id == id) {
+	    return iter.data;
+	}
+    }
+    return NULL;
+}
+
+///
+///	Query the picture formats of the XRender extension.
+///
+///	@param screen_iter[OUT]	picture formats of screen @p screen_nr
+///	@param screen_nr	screen number of connection
+///
+///	@returns reply of render query picture formats, NULL if XRender
+///	isn't available.  The reply must be freed by the caller.
+///
+static xcb_render_query_pict_formats_reply_t *VideoRenderFormats(int
+    screen_nr, xcb_render_pictscreen_iterator_t * screen_iter)
+{
+    const xcb_query_extension_reply_t *extension;
+    xcb_render_query_version_reply_t *version;
+    xcb_render_query_pict_formats_reply_t *formats;
+    int i;
+
+    extension = xcb_get_extension_data(Connection, &xcb_render_id);
+    if (!extension || !extension->present) {
+	Warning(_("video: no XRender extension\n"));
+	return NULL;
+    }
+    version =
+	xcb_render_query_version_reply(Connection,
+	xcb_render_query_version(Connection, 0, 11), NULL);
+    if (!version) {
+	return NULL;
+    }
+    Debug(3, "video: XRender %d.%d\n", version->major_version,
+	version->minor_version);
+    free(version);
+
+    formats =
+	xcb_render_query_pict_formats_reply(Connection,
+	xcb_render_query_pict_formats(Connection), NULL);
+    if (!formats) {
+	return NULL;
+    }
+
+    *screen_iter = xcb_render_query_pict_formats_screens_iterator(formats);
+    for (i = 0; i < screen_nr && screen_iter->rem; ++i) {
+	xcb_render_pictscreen_next(screen_iter);
+    }
+    if (!screen_iter->rem) {
+	free(formats);
+	return NULL;
+    }
+    return formats;
+}
+
+///
+///	Find 32 bit argb visual and its picture format.
+///
+///	Only a8r8g8b8 is supported, this is the layout of the osd pixels.
+///
+///	@param screen_nr	screen number of connection
+///
+///	@returns true if argb visual is available.
+///
+static int VideoArgbInit(int screen_nr)
+{
+    xcb_render_query_pict_formats_reply_t *formats;
+    xcb_render_pictscreen_iterator_t screen_iter;
+    xcb_render_pictdepth_iterator_t depth_iter;
+
+    if (!(formats = VideoRenderFormats(screen_nr, &screen_iter))) {
+	return 0;
+    }
+
+    VideoOsdVisual = XCB_NONE;
+    depth_iter = xcb_render_pictscreen_depths_iterator(screen_iter.data);
+    for (; depth_iter.rem && VideoOsdVisual == XCB_NONE;
+	xcb_render_pictdepth_next(&depth_iter)) {
+	xcb_render_pictvisual_iterator_t visual_iter;
+
+	if (depth_iter.data->depth != 32) {
+	    continue;
+	}
+	visual_iter = xcb_render_pictdepth_visuals_iterator(depth_iter.data);
+	for (; visual_iter.rem; xcb_render_pictvisual_next(&visual_iter)) {
+	    const xcb_render_pictforminfo_t *info;
+
+	    info = VideoFindPictFormat(formats, visual_iter.data->format);
+	    if (info && info->type == XCB_RENDER_PICT_TYPE_DIRECT
+		&& info->direct.alpha_mask == 0xFF
+		&& info->direct.alpha_shift == 24
+		&& info->direct.red_shift == 16
+		&& info->direct.green_shift == 8
+		&& info->direct.blue_shift == 0) {
+		VideoOsdVisual = visual_iter.data->visual;
+		VideoOsdFormat = info->id;
+		break;
+	    }
+	}
+    }
+    free(formats);
+
+    if (VideoOsdVisual == XCB_NONE) {
+	Warning(_("video: no 32 bit argb visual\n"));
+	return 0;
+    }
+    Debug(3, "video: argb visual %#0x format %#0x\n", VideoOsdVisual,
+	VideoOsdFormat);
+    VideoOsdDepth = 32;
+    return 1;
+}
+
+///
+///	Check if a compositing manager runs on the screen.
+///
+///	Only top-level windows are blended by a compositing manager, without
+///	it the transparent pixels of an argb window are black.
+///
+///	@param screen_nr	screen number of connection
+///
+///	@returns true if the _NET_WM_CM_S<screen> selection has an owner.
+///
+static int VideoCompositorInit(int screen_nr)
+{
+    xcb_intern_atom_reply_t *atom;
+    xcb_get_selection_owner_reply_t *owner;
+    char name[32];
+    int n;
+
+    n = snprintf(name, sizeof(name), "_NET_WM_CM_S%d", screen_nr);
+    atom =
+	xcb_intern_atom_reply(Connection, xcb_intern_atom(Connection, 0, n,
+	    name), NULL);
+    if (!atom) {
+	return 0;
+    }
+    owner =
+	xcb_get_selection_owner_reply(Connection,
+	xcb_get_selection_owner(Connection, atom->atom), NULL);
+    free(atom);
+    if (!owner) {
+	return 0;
+    }
+    n = owner->owner != XCB_NONE;
+    free(owner);
+
+    if (!n) {
+	Warning(_("video: no compositing manager running\n"));
+    }
+    return n;
+}
+
+///
+///	Find the picture format of the osd visual.
+///
+///	Needed to scale the osd of a color key visual with XRender.
+///
+///	@param screen_nr	screen number of connection
+///
+///	@returns true if the picture format is found.
+///
+static int VideoOsdFormatInit(int screen_nr)
+{
+    xcb_render_query_pict_formats_reply_t *formats;
+    xcb_render_pictscreen_iterator_t screen_iter;
+    xcb_render_pictdepth_iterator_t depth_iter;
+
+    if (!(formats = VideoRenderFormats(screen_nr, &screen_iter))) {
+	return 0;
+    }
+
+    VideoOsdFormat = XCB_NONE;
+    depth_iter = xcb_render_pictscreen_depths_iterator(screen_iter.data);
+    for (; depth_iter.rem && VideoOsdFormat == XCB_NONE;
+	xcb_render_pictdepth_next(&depth_iter)) {
+	xcb_render_pictvisual_iterator_t visual_iter;
+
+	visual_iter = xcb_render_pictdepth_visuals_iterator(depth_iter.data);
+	for (; visual_iter.rem; xcb_render_pictvisual_next(&visual_iter)) {
+	    if (visual_iter.data->visual == VideoOsdVisual) {
+		VideoOsdFormat = visual_iter.data->format;
+		break;
+	    }
+	}
+    }
+    free(formats);
+
+    return VideoOsdFormat != XCB_NONE;
+}
+
+///
+///	Set the scale transform and filter of the osd pixmap picture.
+///
+///	The transform maps window coordinates to osd coordinates.  The color
+///	key must not be blended with its neighbours, color key osds use the
+///	nearest pixel, argb osds bilinear filtering.
+///
+static void VideoScaleInit(void)
+{
+    xcb_render_transform_t transform;
+    const char *filter;
+
+    memset(&transform, 0, sizeof(transform));
+    transform.matrix11 =
+	(xcb_render_fixed_t) (((int64_t) VideoOsdWidth << 16) /
+	VideoWindowWidth);
+    transform.matrix22 =
+	(xcb_render_fixed_t) (((int64_t) VideoOsdHeight << 16) /
+	VideoWindowHeight);
+    transform.matrix33 = 1 << 16;
+    xcb_render_set_picture_transform(Connection, VideoPixmapPicture,
+	transform);
+
+    filter = VideoArgb ? "bilinear" : "nearest";
+    xcb_render_set_picture_filter(Connection, VideoPixmapPicture,
+	strlen(filter), filter, 0, NULL);
+
+    Debug(3, "video: osd %dx%d scaled %s into window %dx%d\n",
+	VideoOsdWidth, VideoOsdHeight, filter, VideoWindowWidth,
+	VideoWindowHeight);
+}
+
+///
+///	Find visual type of a visual of the video screen.
+///
+///	@param visual	visual id
+///
+///	@returns visual type, NULL if not found.
+///
+static const xcb_visualtype_t *VideoFindVisualType(xcb_visualid_t visual)
+{
+    xcb_depth_iterator_t depth_iter;
+
+    depth_iter = xcb_screen_allowed_depths_iterator(VideoScreen);
+    for (; depth_iter.rem; xcb_depth_next(&depth_iter)) {
+	xcb_visualtype_iterator_t visual_iter;
+
+	visual_iter = xcb_depth_visuals_iterator(depth_iter.data);
+	for (; visual_iter.rem; xcb_visualtype_next(&visual_iter)) {
+	    if (visual_iter.data->visual_id == visual) {
+		return visual_iter.data;
+	    }
+	}
+    }
+    return NULL;
+}
+
 ///
 ///	Initialize video.
 ///
@@ -597,6 +3778,10 @@ int VideoInit(const char *display)
     const char *display_name;
     xcb_connection_t *connection;
     xcb_screen_iterator_t iter;
+    xcb_format_iterator_t format_iter;
+    const xcb_visualtype_t *visual_type;
+    xcb_rectangle_t rect;
+    uint32_t values[2];
     int screen_nr;
     int i;
 
@@ -618,6 +3803,54 @@ int VideoInit(const char *display)
     }
     VideoScreen = iter.data;
 
+    //	Maximal request length, enables BIG-REQUESTS if available
+    VideoMaxRequestBytes =
+	(size_t) xcb_get_maximum_request_length(Connection) * 4;
+    Debug(3, "video: maximal request length %zu bytes\n",
+	VideoMaxRequestBytes);
+
+    //	Osd visual: argb if requested and available, otherwise root visual
+    if (VideoArgb && (!VideoCompositorInit(screen_nr)
+	    || !VideoArgbInit(screen_nr))) {
+	Warning(_("video: argb osd not available, using color key\n"));
+	VideoArgb = 0;
+    }
+    if (!VideoArgb) {
+	VideoOsdVisual = VideoScreen->root_visual;
+	VideoOsdDepth = VideoScreen->root_depth;
+    }
+    // colorkey or fully transparent
+    VideoOsdKey = VideoArgb ? 0x00000000 : VideoColorKey;
+
+    //	Get the image format of the osd depth
+    VideoByteOrder = xcb_get_setup(connection)->image_byte_order;
+    VideoBitsPerPixel = 0;
+    format_iter = xcb_setup_pixmap_formats_iterator(xcb_get_setup(connection));
+    for (; format_iter.rem; xcb_format_next(&format_iter)) {
+	if (format_iter.data->depth == VideoOsdDepth) {
+	    VideoBitsPerPixel = format_iter.data->bits_per_pixel;
+	    VideoScanlinePad = format_iter.data->scanline_pad;
+	    break;
+	}
+    }
+    Debug(3, "video: depth %d, %d bpp, %s first\n", VideoOsdDepth,
+	VideoBitsPerPixel,
+	VideoByteOrder == XCB_IMAGE_ORDER_LSB_FIRST ? "lsb" : "msb");
+
+    //	Get the color masks of the osd visual
+    if ((visual_type = VideoFindVisualType(VideoOsdVisual))) {
+	if (visual_type->_class != XCB_VISUAL_CLASS_TRUE_COLOR
+	    && visual_type->_class != XCB_VISUAL_CLASS_DIRECT_COLOR) {
+	    Warning(_("video: osd needs a true color visual\n"));
+	}
+	VideoRedMask = visual_type->red_mask;
+	VideoGreenMask = visual_type->green_mask;
+	VideoBlueMask = visual_type->blue_mask;
+    }
+
+    VideoConvertInit();
+    VideoOsdKeyPixel = VideoNativePixel(VideoOsdKey);
+
     //
     //	Default window size
     //
@@ -632,18 +3865,101 @@ int VideoInit(const char *display)
     if (!VideoWindowWidth) {
 	VideoWindowWidth = (VideoWindowHeight * 16) / 9;
     }
+    //	Fixed osd size is scaled into the window, otherwise window size
+    VideoOsdWidth = VideoConfigOsdWidth;
+    VideoOsdHeight = VideoConfigOsdHeight;
+    if (!VideoOsdWidth || !VideoOsdHeight) {
+	VideoOsdWidth = VideoWindowWidth;
+	VideoOsdHeight = VideoWindowHeight;
+    }
+    VideoOsdScaled = VideoOsdWidth != VideoWindowWidth
+	|| VideoOsdHeight != VideoWindowHeight;
+    if (VideoOsdScaled && !VideoArgb && !VideoOsdFormatInit(screen_nr)) {
+	Warning(_("video: osd scaling not available, using window size\n"));
+	VideoOsdScaled = 0;
+	VideoOsdWidth = VideoWindowWidth;
+	VideoOsdHeight = VideoWindowHeight;
+    }
 
+    VideoColormap = xcb_generate_id(Connection);
+    xcb_create_colormap(Connection, XCB_COLORMAP_ALLOC_NONE, VideoColormap,
+	VideoScreen->root, VideoScreen->root_visual);
     VideoPlayWindow =
 	VideoCreateWindow(VideoScreen->root, VideoScreen->root_visual,
-	VideoScreen->root_depth);
+	VideoScreen->root_depth, VideoColormap,
+	VideoArgb ? VideoColorKey : VideoOsdKeyPixel, 0);
     xcb_map_window(Connection, VideoPlayWindow);
+    if (VideoArgb) {
+	// argb window needs its own colormap
+	VideoOsdColormap = xcb_generate_id(Connection);
+	xcb_create_colormap(Connection, XCB_COLORMAP_ALLOC_NONE,
+	    VideoOsdColormap, VideoScreen->root, VideoOsdVisual);
+    }
+    // argb osd is a top-level window, only those are blended
     VideoOsdWindow =
-	VideoCreateWindow(VideoPlayWindow, VideoScreen->root_visual,
-	VideoScreen->root_depth);
+	VideoCreateWindow(VideoArgb ? VideoScreen->root : VideoPlayWindow,
+	VideoOsdVisual, VideoOsdDepth,
+	VideoArgb ? VideoOsdColormap : VideoColormap, VideoOsdKeyPixel,
+	VideoArgb);
     Debug(3, "play: osd %x, play %x\n", VideoOsdWindow, VideoPlayWindow);
 
-    VideoWindowClear();
-    // done by clear: xcb_flush(Connection);
+    // exposes are repainted from the backing pixmap, no background
+    values[0] = XCB_BACK_PIXMAP_NONE;
+    xcb_change_window_attributes(Connection, VideoOsdWindow,
+	XCB_CW_BACK_PIXMAP, values);
+
+    // copies from the backing pixmap need no graphics exposures
+    values[0] = VideoOsdKeyPixel;
+    values[1] = 0;
+    VideoOsdForeground = VideoOsdKeyPixel;
+    VideoOsdGC = xcb_generate_id(Connection);
+    xcb_create_gc(Connection, VideoOsdGC, VideoOsdWindow,
+	XCB_GC_FOREGROUND | XCB_GC_GRAPHICS_EXPOSURES, values);
+
+    //	backing store of osd window, starts transparent like the surface
+    VideoOsdPixmap = xcb_generate_id(Connection);
+    xcb_create_pixmap(Connection, VideoOsdDepth, VideoOsdPixmap,
+	VideoOsdWindow, VideoOsdWidth, VideoOsdHeight);
+    rect.x = 0;
+    rect.y = 0;
+    rect.width = VideoOsdWidth;
+    rect.height = VideoOsdHeight;
+    xcb_poly_fill_rectangle(Connection, VideoOsdPixmap, VideoOsdGC, 1, &rect);
+
+    if (VideoShape && !VideoShapeInit()) {
+	Warning(_("video: osd shape not available, using color key\n"));
+	VideoShape = 0;
+    }
+
+    if (VideoArgb || VideoOsdScaled) {
+	// pixmap is composited into the window, scaled pads its edges
+	values[0] = XCB_RENDER_REPEAT_PAD;
+	VideoPixmapPicture = xcb_generate_id(Connection);
+	xcb_render_create_picture(Connection, VideoPixmapPicture,
+	    VideoOsdPixmap, VideoOsdFormat,
+	    VideoOsdScaled ? XCB_RENDER_CP_REPEAT : 0, values);
+	VideoOsdPicture = xcb_generate_id(Connection);
+	xcb_render_create_picture(Connection, VideoOsdPicture, VideoOsdWindow,
+	    VideoOsdFormat, 0, NULL);
+	if (VideoOsdScaled) {
+	    VideoScaleInit();
+	}
+    }
+
+    // only whole byte pixel formats are supported
+    if (VideoBitsPerPixel % 8) {
+	Error(_("video: unsupported %d bits per pixel\n"),
+	    VideoBitsPerPixel);
+    } else {
+	// shared memory only works, if the server runs on this machine
+	VideoOsdSurfaceInit(VideoIsLocalDisplay(display_name));
+    }
+
+    xcb_flush(Connection);
+
+    VideoWorkerInit();
+    // from now on the connection belongs to the video thread
+    VideoThreadInit();
 
     return 0;
 }
@@ -653,6 +3969,39 @@ int VideoInit(const char *display)
 ///
 void VideoExit(void)
 {
+    VideoThreadExit();
+    VideoWorkerExit();
+    VideoOsdSurfaceExit();
+    if (VideoOsdGC != XCB_NONE) {
+	xcb_free_gc(Connection, VideoOsdGC);
+	VideoOsdGC = XCB_NONE;
+    }
+    free(VideoImageData);
+    VideoImageData = NULL;
+    VideoImageSize = 0;
+    free(VideoScrollHashes);
+    VideoScrollHashes = NULL;
+    VideoScrollHashN = 0;
+    free(VideoShapeRects);
+    VideoShapeRects = NULL;
+    VideoShapeSize = 0;
+    VideoOsdMapPending = 0;
+    // derived again from the configured size by VideoInit
+    VideoOsdWidth = 0;
+    VideoOsdHeight = 0;
+    VideoOsdScaled = 0;
+    if (VideoOsdPicture != XCB_NONE) {
+	xcb_render_free_picture(Connection, VideoOsdPicture);
+	VideoOsdPicture = XCB_NONE;
+    }
+    if (VideoPixmapPicture != XCB_NONE) {
+	xcb_render_free_picture(Connection, VideoPixmapPicture);
+	VideoPixmapPicture = XCB_NONE;
+    }
+    if (VideoOsdPixmap != XCB_NONE) {
+	xcb_free_pixmap(Connection, VideoOsdPixmap);
+	VideoOsdPixmap = XCB_NONE;
+    }
     if (VideoOsdWindow != XCB_NONE) {
 	xcb_destroy_window(Connection, VideoOsdWindow);
 	VideoOsdWindow = XCB_NONE;
@@ -665,6 +4014,10 @@ void VideoExit(void)
 	xcb_free_colormap(Connection, VideoColormap);
 	VideoColormap = XCB_NONE;
     }
+    if (VideoOsdColormap != XCB_NONE) {
+	xcb_free_colormap(Connection, VideoOsdColormap);
+	VideoOsdColormap = XCB_NONE;
+    }
     if (VideoBlankCursor != XCB_NONE) {
 	xcb_free_cursor(Connection, VideoBlankCursor);
 	VideoBlankCursor = XCB_NONE;
@@ -35,24 +35,44 @@ extern void VideoWindowHide(void);
     /// Clear window.
 extern void VideoWindowClear(void);
 
-    /// Poll video events.
-extern void VideoPollEvents(int);
-
     /// Get player window id.
 extern int VideoGetPlayWindow(void);
 
     /// Draw an OSD ARGB image.
 extern void VideoDrawARGB(int, int, int, int, const uint8_t *);
 
+    /// Release of an image handed over to the video module.
+typedef void VideoReleaseFunc(void *);
+
+    /// Draw an OSD ARGB image, handed over to the video module.
+extern void VideoDrawARGBImage(int, int, int, int, const uint8_t *,
+    VideoReleaseFunc *, void *);
+
+    /// Draw an OSD palette indexed image.
+extern void VideoDrawIndexed(int, int, int, int, const uint8_t *, int,
+    const uint32_t *, int);
+
+    /// Upload all OSD changes since last flush.
+extern void VideoOsdFlush(void);
+
     /// Get OSD size.
 extern void VideoGetOsdSize(int *, int *);
 
     /// Set video geometry.
 extern void VideoSetGeometry(const char *);
 
+    /// Set fixed OSD size.
+extern void VideoSetOsdSize(const char *);
+
     /// Set video color key.
 extern void VideoSetColorKey(uint32_t);
 
+    /// Set video osd argb mode.
+extern void VideoSetArgb(int);
+
+    /// Set video osd shape mode.
+extern void VideoSetShape(int);
+
 extern int VideoInit(const char *);	///< Setup video module.
 extern void VideoExit(void);		///< Cleanup and exit video module.
 